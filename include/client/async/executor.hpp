@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "client/async/task.hpp"
+
+// Read side of a cancellation flag. A default constructed token is never
+// cancelled.
+class CancellationToken {
+public:
+    CancellationToken() = default;
+
+    bool cancelled() const;
+    bool can_cancel() const { return state_ != nullptr; }
+
+    // Runs `fn` once when the token gets cancelled, on the cancelling thread.
+    // Returns 0 without registering if it already is.
+    uint64_t subscribe(std::function<void()> fn) const;
+    void unsubscribe(uint64_t id) const;
+
+private:
+    friend class CancellationSource;
+
+    struct State {
+        std::mutex mtx;
+        std::atomic<bool> cancelled{false};
+        uint64_t next_id = 1;
+        std::map<uint64_t, std::function<void()>> callbacks;
+    };
+
+    std::shared_ptr<State> state_;
+};
+
+class CancellationSource {
+public:
+    CancellationSource();
+    // Also cancelled when `parent` is
+    explicit CancellationSource(const CancellationToken& parent);
+    ~CancellationSource();
+
+    CancellationSource(const CancellationSource&) = delete;
+    CancellationSource& operator=(const CancellationSource&) = delete;
+
+    CancellationToken token() const { return token_; }
+    bool cancelled() const { return token_.cancelled(); }
+    void cancel();
+
+private:
+    static void cancel_state(const std::shared_ptr<CancellationToken::State>& state);
+
+    CancellationToken token_;
+    CancellationToken parent_;
+    uint64_t parent_sub_ = 0;
+};
+
+namespace detail {
+
+struct Detached;
+
+// One suspended coroutine that several sources (timer, event, cancellation)
+// may wake. The first one wins, the others find it fired and do nothing.
+struct Waiter {
+    enum Reason { NONE, SIGNALED, TIMED_OUT, CANCELLED };
+
+    std::coroutine_handle<> handle;
+    std::atomic<bool> fired{false};
+    Reason reason = NONE;
+    CancellationToken token;
+    uint64_t token_sub = 0;
+
+    // Resumes the coroutine on the executor, false if someone was first
+    bool fire(Reason why);
+    // Hooks up the token, false if it is cancelled already
+    bool watch(const std::shared_ptr<Waiter>& self, const CancellationToken& t);
+};
+
+}
+
+// Runs all background work of the client: a fixed pool of worker threads
+// resuming coroutines, and one timer thread. Nothing here sleeps, idle
+// threads block on a condition variable until there is work or a deadline.
+class Executor {
+public:
+    static constexpr std::chrono::seconds SHUTDOWN_GRACE{5};
+
+    static Executor& instance();
+
+    // Runs the task on a worker. The executor owns it from here on,
+    // exceptions are logged.
+    void spawn(Task<> task);
+
+    // Same for a task with a result, which is dropped
+    template <class T>
+    void spawn(Task<T> task) {
+        spawn(discard_result(std::move(task)));
+    }
+
+    // Runs a plain function on a worker
+    void post(std::function<void()> fn);
+
+    // Awaitable: continues the calling coroutine on a worker
+    auto schedule() {
+        struct Awaiter {
+            Executor* executor;
+            bool await_ready() const noexcept { return false; }
+            void await_suspend(std::coroutine_handle<> h) { executor->post([h] { h.resume(); }); }
+            void await_resume() const noexcept {}
+        };
+        return Awaiter{this};
+    }
+
+    // Awaitable timer, true after the full delay, false when `token` was
+    // cancelled first
+    auto sleep_for(std::chrono::steady_clock::duration delay, CancellationToken token = {}) {
+        struct Awaiter {
+            Executor* executor;
+            std::chrono::steady_clock::time_point deadline;
+            CancellationToken token;
+            std::shared_ptr<detail::Waiter> waiter;
+
+            bool await_ready() const { return token.cancelled(); }
+            void await_suspend(std::coroutine_handle<> h) {
+                // Once the waiter is armed the coroutine may resume on another
+                // thread and this awaiter go away, so nothing of it is used after
+                Executor* ex = executor;
+                auto when = deadline;
+                auto w = std::make_shared<detail::Waiter>();
+                w->handle = h;
+                waiter = w;
+                if (!w->watch(w, token)) {
+                    w->fire(detail::Waiter::CANCELLED);
+                    return;
+                }
+                ex->add_timer(when, std::move(w));
+            }
+            bool await_resume() const {
+                return waiter ? waiter->reason == detail::Waiter::TIMED_OUT : !token.cancelled();
+            }
+        };
+        return Awaiter{this, std::chrono::steady_clock::now() + delay, std::move(token), nullptr};
+    }
+
+    // Cancelled by shutdown(), long running tasks should watch it
+    CancellationToken token() const { return root_.token(); }
+
+    // Cancels token(), which aborts the requests in flight, and waits up to
+    // SHUTDOWN_GRACE for the spawned tasks to finish. Tasks still suspended
+    // then are abandoned, the threads are joined. Call before curl cleanup.
+    void shutdown();
+
+    size_t workers() const { return workers_.size(); }
+
+    void add_timer(std::chrono::steady_clock::time_point deadline,
+                   std::shared_ptr<detail::Waiter> waiter);
+
+    Executor(const Executor&) = delete;
+    Executor& operator=(const Executor&) = delete;
+
+private:
+    Executor();
+    ~Executor();
+
+    struct Timer {
+        std::chrono::steady_clock::time_point deadline;
+        std::shared_ptr<detail::Waiter> waiter;
+        bool operator>(const Timer& o) const { return deadline > o.deadline; }
+    };
+
+    static detail::Detached run_root(Executor& executor, Task<> task);
+
+    template <class T>
+    static Task<> discard_result(Task<T> task) {
+        co_await std::move(task);
+    }
+
+    void worker_loop();
+    void timer_loop();
+    void task_finished();
+
+    std::mutex mtx_;
+    std::condition_variable work_cv_;       // jobs queued or stopping
+    std::condition_variable idle_cv_;       // a spawned task finished
+    std::deque<std::function<void()>> jobs_;
+    size_t outstanding_ = 0;                // spawned tasks not finished yet
+    bool stopping_ = false;
+
+    std::mutex timer_mtx_;
+    std::condition_variable timer_cv_;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers_;
+    bool timers_stopping_ = false;
+
+    CancellationSource root_;
+    std::vector<std::thread> workers_;
+    std::thread timer_thread_;
+};
+
+// Manual reset event for coroutines. set() wakes every waiter, waits that
+// start while it is set return at once.
+class AsyncEvent {
+public:
+    void set();
+    void reset();
+    bool is_set() const;
+
+    // Awaitable, true when the event was set, false on cancellation
+    auto wait(CancellationToken token = {}) { return Awaiter{this, std::nullopt, std::move(token), nullptr}; }
+
+    // Same with a timeout, false when it passed first
+    auto wait_for(std::chrono::steady_clock::duration timeout, CancellationToken token = {}) {
+        return Awaiter{this, std::chrono::steady_clock::now() + timeout, std::move(token), nullptr};
+    }
+
+private:
+    struct Awaiter {
+        AsyncEvent* event;
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+        CancellationToken token;
+        std::shared_ptr<detail::Waiter> waiter;
+
+        bool await_ready() const { return event->is_set() || token.cancelled(); }
+        void await_suspend(std::coroutine_handle<> h);
+        bool await_resume() const {
+            return waiter ? waiter->reason == detail::Waiter::SIGNALED : event->is_set();
+        }
+    };
+
+    mutable std::mutex mtx_;
+    bool set_ = false;
+    std::vector<std::shared_ptr<detail::Waiter>> waiters_;
+};
@@ -16,17 +16,50 @@
  */
 
 #pragma once
+#include <algorithm>
 #include <string>
 #include <vector>
 #include <atomic>
+#include <cstddef>
+#include <mutex>
+
+#include "client/feed/feed.hpp"
+#include "client/pionniers/directory.hpp"
 
 // Константы
 namespace Config {
     static const std::string DATA_DIR = "data";
-    static const std::string PIONEERS_FILE = "data/pioneers.json";
-    static const std::string GATES_FILE = "data/gates.txt";
+    static const std::string NODES_FILE = "data/nodes.db";
+    static const std::string PIONEERS_FILE = "data/pioneers.json";     // legacy, imported once
+    static const std::string GATES_FILE = "data/gates.txt";            // legacy, imported once
+    static const std::string FEED_CACHE_FILE = "data/feed.cache";
+    static const size_t FEED_CACHE_MAX_POSTS = 5000;             // newest posts kept on disk
+    static const size_t FEED_CACHE_MAX_BYTES = 16 * 1024 * 1024;
     static const std::string DEFAULT_GATE = "3oncms4bmvcv6jvwgzjvovfuhlx6pdho26lo6jny3ruu3hpgz7belzqd.onion";
     static const std::string DEFAULT_PIONEER = "5krka4isaabbpp7fbs3rqacryhvzxpx2b6sirabhbo73bolfbjs5yrqd.onion";
+    static const std::string SOCKS_PROXY = "socks5h://127.0.0.1:9050";
+    static const size_t FANOUT_CONCURRENCY = 8;      // parallel requests per fan-out
+    static const size_t READ_REPLICAS = 2;           // least pioneers a feed refresh reads from, 0 = all
+    static const size_t WRITE_QUORUM = 2;            // least pioneer acks before a post counts as published
+    static const int PUBLISH_RETRIES = 3;            // failed attempts before giving up on a straggler
+    static const int PUBLISH_RETRY_DELAY_S = 5;      // first retry delay, doubles each time
+    static const int PUBLISH_WAIT_S = 30;            // how long publishing waits for the quorum
+    static const std::string OUTBOX_FILE = "data/outbox.journal";
+    // Threads running background tasks. Requests are awaited on the
+    // CurlReactor thread, workers only run the code between them (parsing,
+    // merging, disk writes).
+    static const size_t ASYNC_WORKERS = 4;
+
+    // Quorums for `n` known pioneers. A post is published once a majority
+    // has it and a refresh reads enough pioneers that the two always share
+    // one: read + write > n.
+    inline size_t write_quorum(size_t n) {
+        return std::min(n, std::max(WRITE_QUORUM, n / 2 + 1));
+    }
+    inline size_t read_replicas(size_t n) {
+        if (READ_REPLICAS == 0) return n;
+        return std::min(n, std::max(READ_REPLICAS, n - write_quorum(n) + 1));
+    }
 }
 
 // Page enum
@@ -40,9 +73,9 @@ enum Page {
 
 // Global state (extern declarations)
 extern std::vector<std::string> gates;
-extern std::vector<std::string> posts_cache;
-extern std::vector<std::string> pioneers;
-extern std::string pioneers_source;
+extern std::vector<FeedPost> posts_cache;
+extern std::mutex posts_mutex;                  // guards posts_cache
+extern PioneerDirectory pioneers;
 extern std::atomic<bool> tor_ready;
 extern std::atomic<int> loading_progress;
 extern std::atomic<Page> current_page;
\ No newline at end of file
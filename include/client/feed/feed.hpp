@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+struct FeedPost {
+    uint64_t hash;      // post_hash(text), identifies the post across pioneers
+    std::string text;
+};
+
+// 64-bit FNV-1a of the post text
+uint64_t post_hash(std::string_view text);
+
+// Merges feed responses from several pioneers into one list without
+// duplicates. Posts keep the order in which they were first seen.
+class FeedMerger {
+public:
+    explicit FeedMerger(std::vector<FeedPost>& out);
+
+    // False if the post is already in the feed
+    bool add(std::string text);
+
+    bool contains(const std::string& text) const;
+
+    size_t size() const { return out_.size(); }
+
+private:
+    std::vector<FeedPost>& out_;
+    std::unordered_multimap<uint64_t, size_t> index_;   // hash -> position in out_
+};
+
+// Splits a /get_posts response into posts while it downloads. Chunks go in
+// straight from the curl write callback, only the unfinished tail of the
+// current post is kept between calls.
+class PostStreamParser {
+public:
+    using Sink = std::function<void(std::string)>;
+
+    static constexpr size_t MAX_POST_SIZE = 1 << 20;   // longer posts are dropped
+
+    explicit PostStreamParser(Sink sink);
+
+    void feed(std::string_view chunk);
+
+    // End of body: the last post has no delimiter after it
+    void finish();
+
+    size_t emitted() const { return emitted_; }
+
+private:
+    void emit(std::string_view post);
+
+    Sink sink_;
+    std::string carry_;         // start of a post cut by the chunk boundary
+    bool skipping_ = false;     // inside an oversized post, drop until the next delimiter
+    size_t emitted_ = 0;
+};
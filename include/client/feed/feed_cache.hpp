@@ -0,0 +1,39 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+
+// On-disk copy of the feed (Config::FEED_CACHE_FILE), so the client can show
+// the last known posts at launch, before Tor is up.
+//
+// Layout: 8 byte magic, then one record per post in feed order:
+//   u64 hash | u32 length | text        (little endian, no padding)
+// Records are appended as the feed grows. The hash doubles as a checksum: a
+// torn or damaged tail is cut off on load. Only the newest posts within
+// Config::FEED_CACHE_MAX_POSTS / FEED_CACHE_MAX_BYTES are kept: the file is
+// rewritten to them on load, and when appends take it past twice the cap.
+// The magic is "TSPFEED1", or "TSPFEEDW" once older posts were dropped.
+
+// Loads the cached posts into posts_cache, returns how many were loaded
+size_t load_feed_cache();
+
+// Appends the posts added to posts_cache since the last load/append
+bool append_feed_cache();
+
+// True when the loaded posts are only the newest part of the feed, older
+// posts sent by pioneers must not be appended after them
+bool feed_cache_windowed();
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <curl/curl.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Per-host pool of reusable easy handles.
+// All handles share one CURLSH with the DNS and TLS session caches. Open
+// connections are not shared: libcurl's connection cache is not safe to
+// drive from several threads at once. They stay in the multi handle of the
+// CurlReactor, the one thread running transfers, so a repeated request to
+// the same pioneer or gate rides the already open SOCKS/Tor stream instead
+// of doing the handshake again.
+class CurlPool {
+public:
+    static constexpr size_t MAX_IDLE_PER_HOST = 4;
+
+    static CurlPool& instance();
+
+    // Handle reset to the client defaults (proxy, share, no signals).
+    // Caller sets URL, callbacks and timeouts. nullptr if curl fails.
+    CURL* acquire(const std::string& url);
+    void release(const std::string& url, CURL* easy);
+
+    // Frees every idle handle and the share, call before curl_global_cleanup
+    void shutdown();
+
+    CurlPool(const CurlPool&) = delete;
+    CurlPool& operator=(const CurlPool&) = delete;
+
+private:
+    CurlPool();
+    ~CurlPool();
+
+    static void lock_cb(CURL* handle, curl_lock_data data, curl_lock_access access, void* userptr);
+    static void unlock_cb(CURL* handle, curl_lock_data data, void* userptr);
+
+    CURLSH* share_ = nullptr;
+    std::mutex share_locks_[CURL_LOCK_DATA_LAST];
+
+    std::mutex mtx_;
+    std::unordered_map<std::string, std::vector<CURL*>> idle_;
+};
+
+// "http://host:port/path" -> "host:port"
+std::string url_host(const std::string& url);
+
+// Returns the handle to the pool when it goes out of scope
+class PooledCurl {
+public:
+    explicit PooledCurl(const std::string& url)
+        : url_(url), easy_(CurlPool::instance().acquire(url)) {}
+    ~PooledCurl() {
+        if (easy_) CurlPool::instance().release(url_, easy_);
+    }
+
+    PooledCurl(const PooledCurl&) = delete;
+    PooledCurl& operator=(const PooledCurl&) = delete;
+
+    CURL* get() const { return easy_; }
+    explicit operator bool() const { return easy_ != nullptr; }
+
+private:
+    std::string url_;
+    CURL* easy_;
+};
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <curl/curl.h>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "client/async/executor.hpp"
+
+// Runs every transfer of the client on one thread. It owns the multi handle
+// (and with it the connection cache), sleeps in curl_multi_poll() until a
+// socket or timer of a transfer is due, and hands finished transfers back
+// through a callback. Coroutines await them, so no executor worker is held
+// while a request is on the wire.
+class CurlReactor {
+public:
+    // Runs on the reactor thread once the transfer finished, or was removed
+    // (CURLE_ABORTED_BY_CALLBACK). curl is done with the handle by then.
+    using DoneFn = std::function<void(CURLcode)>;
+
+    static CurlReactor& instance();
+
+    // Starts the transfer and returns its id. After shutdown() `done` gets
+    // CURLE_FAILED_INIT right away, on the calling thread, and the id is 0.
+    uint64_t add(CURL* easy, DoneFn done);
+    // Stops a running transfer early, its `done` still runs. Ids that
+    // already finished are ignored.
+    void remove(uint64_t id);
+
+    // Awaitable transfer of one handle. When `token` is cancelled the
+    // transfer is removed, and this completes once curl let go of it.
+    Task<CURLcode> perform(CURL* easy, CancellationToken token = Executor::instance().token());
+
+    // Aborts whatever still runs and joins the thread. Call after the
+    // Executor shut down, before CurlPool::shutdown().
+    void shutdown();
+
+    CurlReactor(const CurlReactor&) = delete;
+    CurlReactor& operator=(const CurlReactor&) = delete;
+
+private:
+    CurlReactor();
+    ~CurlReactor();
+
+    struct Added {
+        uint64_t id;
+        CURL* easy;
+        DoneFn done;
+    };
+
+    struct Running {
+        uint64_t id;
+        DoneFn done;
+    };
+
+    void loop();
+    void finish(CURL* easy, CURLcode code);
+
+    std::mutex mtx_;
+    CURLM* multi_ = nullptr;
+    std::vector<Added> added_;              // waiting for the thread
+    std::vector<uint64_t> removed_;
+    uint64_t next_id_ = 1;
+    bool stopping_ = false;
+    std::thread thread_;
+
+    // Reactor thread only
+    std::unordered_map<CURL*, Running> running_;
+};
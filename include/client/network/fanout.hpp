@@ -0,0 +1,74 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <curl/curl.h>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "client/async/executor.hpp"
+#include "client/config.hpp"
+
+struct FanoutRequest {
+    std::string url{};
+    std::optional<std::string> post_body{}; // POST when set, GET otherwise
+    long timeout_ms = 0;                    // 0 = adaptive, from HostHealth; a stall limit when streamed
+
+    // When set, the body is handed over chunk by chunk as it arrives (with
+    // the HTTP status known so far) instead of being collected in `body`.
+    // Runs on the CurlReactor thread, so it must not block.
+    std::function<void(int status, std::string_view chunk)> on_chunk{};
+};
+
+struct FanoutResult {
+    size_t index = 0;                       // position in the request list
+    bool done = false;                      // false if cancelled before finishing
+    bool skipped = false;                   // host's circuit breaker is open
+    CURLcode code = CURLE_OK;
+    int status = 0;                         // HTTP status, 0 when the transfer failed
+    std::string body;                       // empty for streamed requests
+    long elapsed_ms = 0;
+
+    bool ok() const { return done && code == CURLE_OK && status >= 200 && status < 300; }
+};
+
+// Called on the awaiting coroutine as each transfer completes.
+// Return false to cancel everything still in flight.
+using FanoutCallback = std::function<bool(const FanoutResult&)>;
+
+// Runs all requests on the CurlReactor, at most `max_parallel` at a time.
+// Total time is roughly the slowest transfer instead of the sum, and no
+// thread waits for them. Hosts with an open circuit are skipped without a
+// request, every finished transfer is reported to HostHealth. Results come
+// back in request order. Cancelling `token` drops what is still in flight.
+// `requests` must outlive the await.
+Task<std::vector<FanoutResult>> fanout(const std::vector<FanoutRequest>& requests,
+                                       FanoutCallback on_done = nullptr,
+                                       size_t max_parallel = Config::FANOUT_CONCURRENCY,
+                                       CancellationToken token = Executor::instance().token());
+
+// Read from the first k replicas that answer. `requests` are ranked best
+// first, k of them start right away. A replica still running after its
+// hedge_after_ms gets a backup from the next candidate, a failed one is
+// replaced at once. As soon as k answers succeeded the rest is cancelled.
+Task<std::vector<FanoutResult>> fanout_first_k(const std::vector<FanoutRequest>& requests,
+                                               size_t k,
+                                               const std::vector<long>& hedge_after_ms,
+                                               FanoutCallback on_done = nullptr,
+                                               CancellationToken token = Executor::instance().token());
@@ -0,0 +1,98 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+enum class BreakerState {
+    CLOSED,     // healthy, requests go through
+    OPEN,       // failing, requests are skipped until the cooldown ends
+    HALF_OPEN   // cooldown over, one probe request is let through
+};
+
+struct HostStats {
+    double latency_ms = 0;      // EWMA of successful request latency
+    double deviation_ms = 0;    // EWMA of |sample - latency|
+    double error_rate = 0;      // EWMA of failures, 0..1
+    int samples = 0;
+    int consecutive_failures = 0;
+    BreakerState state = BreakerState::CLOSED;
+    std::chrono::steady_clock::time_point open_until{};
+    std::chrono::milliseconds cooldown{0};
+    bool probe_in_flight = false;
+};
+
+// Per-host latency/error tracking for the client.
+// Timeouts follow the observed latency (mean + 4 deviations, times a safety
+// factor) instead of a fixed 10 s, and a circuit breaker stops paying that
+// timeout for hosts that keep failing.
+class HostHealth {
+public:
+    static constexpr double ALPHA = 0.2;                 // EWMA weight of a new sample
+    static constexpr long DEFAULT_TIMEOUT_MS = 10000;    // until we know the host
+    static constexpr long MIN_TIMEOUT_MS = 3000;
+    static constexpr long MAX_TIMEOUT_MS = 20000;
+    static constexpr double TIMEOUT_FACTOR = 2.0;
+    static constexpr int FAILURES_TO_OPEN = 3;
+    static constexpr std::chrono::milliseconds FIRST_COOLDOWN{30000};
+    static constexpr std::chrono::milliseconds MAX_COOLDOWN{600000};
+    static constexpr long MIN_HEDGE_MS = 500;
+    static constexpr long DEFAULT_HEDGE_MS = 4000;
+    // A streamed read slower than this for a whole timeout has stalled
+    static constexpr long STALL_BYTES_PER_S = 1;
+
+    static HostHealth& instance();
+
+    // A separate tracker with its own first cooldown, for tests. The client
+    // shares instance().
+    explicit HostHealth(std::chrono::milliseconds first_cooldown) : first_cooldown_(first_cooldown) {}
+
+    // False while the breaker is open. In half-open state the first caller
+    // gets true (the probe, `*probe` set), everyone else false until it
+    // reports back through record_success/record_failure or abandon().
+    bool allow(const std::string& host, bool* probe = nullptr);
+
+    // The probe was cancelled before it got an answer: frees the slot
+    // without counting for or against the host
+    void abandon(const std::string& host);
+
+    // Time allowed to connect and, for small requests, to get the whole
+    // answer. Streamed reads use it as the longest allowed stall instead.
+    long timeout_ms(const std::string& host);
+
+    // Expected cost of asking this host, lower is better. Open circuits rank
+    // last, unknown hosts in the middle so they still get explored.
+    double score(const std::string& host);
+
+    // Roughly p95 latency: when a read from this host should get a backup
+    long hedge_after_ms(const std::string& host);
+
+    void record_success(const std::string& host, long elapsed_ms);
+    void record_failure(const std::string& host);
+
+    HostStats stats(const std::string& host);
+
+private:
+    HostHealth() = default;
+
+    std::chrono::milliseconds first_cooldown_ = FIRST_COOLDOWN;
+
+    std::mutex mtx_;
+    std::unordered_map<std::string, HostStats> hosts_;
+};
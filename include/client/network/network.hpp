@@ -18,16 +18,54 @@
 #include <string>
 #include <vector>
 #include <utility>
+#include <cstdint>
+#include <functional>
+
+#include "client/async/task.hpp"
+#include "utils/onion/onion_address.hpp"
 
 // СURL callback
 size_t write_cb(char* ptr, size_t size, size_t nmemb, void* userdata);
 
-// Fetch URL with HTTP status
-std::pair<int, std::string> fetch_url_with_status(const std::string &url);
+// Fetch URL with HTTP status, status 0 when there was no answer
+Task<std::pair<int, std::string>> fetch_url_with_status(std::string url);
+
+
+Task<std::vector<std::string>> fetch_servers_from_gates();
+
+// Directory changes reported by one gate since a known version
+struct GateDelta {
+    bool ok = false;
+    bool full = false;          // gate sent its whole list, not a delta
+    bool federated = false;     // gate holds the directory of the whole network
+    uint64_t epoch = 0;
+    uint64_t version = 0;
+    std::vector<OnionAddress> added;
+    std::vector<OnionAddress> removed;
+};
+
+std::string pioneers_delta_url(const std::string &gate, uint64_t epoch, uint64_t version);
+GateDelta parse_pioneers_delta(const std::string &resp);
+Task<GateDelta> fetch_legacy_pioneers(std::string gate);
+Task<GateDelta> fetch_pioneers_delta(std::string gate, uint64_t epoch, uint64_t version);
+
 
+// Streams the feed from the pioneers into posts_cache. on_update is called
+// (throttled, from the CurlReactor thread) whenever new posts became
+// visible, so the UI can redraw before the download finishes. Called while
+// a refresh runs, it waits for that one and returns its result.
+Task<bool> fetch_posts_async(std::function<void()> on_update = nullptr);
 
-std::vector<std::string> fetch_servers_from_gates();
+enum class PublishResult {
+    PUBLISHED,      // Config::write_quorum() pioneers have it
+    QUEUED,         // saved in the outbox, delivery goes on in the background
+    FAILED          // could not even be saved
+};
 
+// Queues the post in the outbox and waits (up to Config::PUBLISH_WAIT_S) for
+// the write quorum without holding a thread. Delivery to the rest continues
+// in the background.
+Task<PublishResult> send_post_to_all(std::string post);
 
-bool fetch_posts();
-bool send_post_to_all(const std::string &post);
+// Stops the outbox delivery task, call before the Executor shuts down
+void wait_background_writes();
@@ -0,0 +1,136 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "client/async/executor.hpp"
+#include "utils/filesys/sync_io.hpp"
+
+// Posts waiting to reach the pioneers. Every post is written to
+// Config::OUTBOX_FILE and synced before the first send, so nothing is lost
+// when all pioneers are down or the client exits. A task on the Executor
+// delivers in rounds: everything pending for every reachable pioneer goes
+// out in one fan-out, and several posts for the same pioneer share one POST
+// /add_posts request. Pioneers without that endpoint get them one by one.
+//
+// Delivery is tracked per pioneer. A pioneer that fails backs off
+// exponentially with jitter, independent of the others. A post is done once
+// every known pioneer has it, or once it reached Config::write_quorum() of
+// them and the stragglers failed Config::PUBLISH_RETRIES times. A post below
+// the quorum is never dropped.
+//
+// Journal lines: "post <id> <len>\n<text>\n", "sent <id> <pioneer>\n",
+// "done <id>\n". It is compacted on start and truncated when the queue runs dry.
+// Framing of POST /add_posts: "<length>\n<post>\n" per post
+std::string encode_post_batch(const std::vector<std::string_view>& posts);
+
+// Per-item results of /add_posts ("<index> ok" lines), true = stored
+std::vector<bool> parse_post_batch_results(std::string_view body, size_t count);
+
+class Outbox {
+public:
+    static constexpr size_t BATCH_LIMIT = 64;           // posts per pioneer per round
+    static constexpr size_t BATCH_MAX_BYTES = 512 * 1024;   // pioneers cap request bodies at 1 MiB
+    static constexpr std::chrono::seconds MAX_BACKOFF{600};
+    static constexpr std::chrono::seconds IDLE_RECHECK{30};  // notice new pioneers
+    static constexpr size_t FINISHED_KEPT = 256;        // results kept for wait_acks
+
+    static Outbox& instance();
+
+    // Loads the journal and starts the delivery task
+    void start();
+    // Stops retries and waits for the delivery task, call before the
+    // Executor shuts down
+    void stop();
+
+    // Persists the post and wakes the delivery task, 0 if it could not be
+    // saved or is larger than a pioneer accepts
+    uint64_t enqueue(const std::string& post);
+
+    // Completes once `acks` pioneers have the post, it finished, or the
+    // timeout passed, with how many pioneers have it
+    Task<size_t> wait_acks(uint64_t id, size_t acks, std::chrono::milliseconds timeout);
+
+    size_t pending();
+
+    Outbox(const Outbox&) = delete;
+    Outbox& operator=(const Outbox&) = delete;
+
+private:
+    using clock_type = std::chrono::steady_clock;
+
+    struct Entry {
+        std::string text;
+        std::set<std::string> delivered;
+        std::map<std::string, int> failures;    // per pioneer, this session
+    };
+
+    struct HostBackoff {
+        int failures = 0;
+        clock_type::time_point next_try{};
+    };
+
+    Outbox() = default;
+    ~Outbox();
+
+    struct AckWaiter {
+        uint64_t id;
+        size_t acks;
+        std::shared_ptr<AsyncEvent> done;
+    };
+
+    Task<> run(CancellationToken stop);
+    // One delivery round, false if nothing was due. Stopping cancels the
+    // requests in flight.
+    Task<bool> deliver_round(CancellationToken stop);
+    bool acked_locked(uint64_t id, size_t acks) const;
+    void notify_acks_locked();
+    void finish_locked(uint64_t id, size_t acks);
+    void schedule_retry_locked(const std::string& pioneer);
+
+    void ensure_loaded_locked();
+    // `sync` waits for the disk, post records need it, sent/done only
+    // cause a resend when lost
+    bool append_locked(const std::string& record, bool sync = false);
+    bool rewrite_locked();
+
+    std::mutex mtx_;
+    sync_io::File journal_;             // kept open between appends
+    std::condition_variable stopped_cv_;    // delivery task finished
+    AsyncEvent wake_;                   // new post or stop
+    std::vector<AckWaiter> ack_waiters_;
+    std::map<uint64_t, Entry> entries_; // oldest first
+    std::map<uint64_t, size_t> finished_;   // acks of recently finished posts, for wait_acks
+    std::map<std::string, HostBackoff> backoff_;
+    std::set<std::string> no_batch_;    // answered 404 to /add_posts
+    uint64_t next_id_ = 1;
+    bool running_ = false;
+    bool stopping_ = false;
+    bool loaded_ = false;
+    std::unique_ptr<CancellationSource> stop_source_;
+    std::mt19937 rng_{std::random_device{}()};
+};
@@ -0,0 +1,110 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "utils/onion/onion_address.hpp"
+
+// Addresses are validated once, where they enter the client (gate replies,
+// argv, the node store), and only turned back into text for I/O
+struct PioneerInfo {
+    OnionAddress address;
+    double score = 0;           // HostHealth::score at the last refresh, lower is better
+    int64_t last_seen = 0;      // unix time of the last successful answer, 0 = never
+    uint64_t gates = 0;         // bit per gate slot whose current list has it
+};
+
+// Gates get one of GATE_SLOTS membership bits, the rest are not tracked
+constexpr int GATE_SLOTS = 64;
+
+// What one gate reported in a directory sync
+struct GateSync {
+    uint64_t bit = 0;           // the gate's slot bit, 0 = not tracked
+    bool full = false;          // `added` is the gate's whole list
+    bool federated = false;     // the gate speaks for every gate
+    std::vector<OnionAddress> added;
+    std::vector<OnionAddress> removed;
+};
+
+// Immutable view of the directory. Readers may hold on to it as long as
+// they like, writers build a new one instead of touching it.
+struct PioneerSnapshot {
+    uint64_t version = 0;
+    std::string source = "default";     // default, file, argv or gates
+    std::vector<PioneerInfo> list;      // in the order they became known
+    std::unordered_map<OnionAddress, size_t> index; // address -> position in list
+
+    size_t size() const { return list.size(); }
+    bool empty() const { return list.empty(); }
+    bool contains(const OnionAddress& address) const { return index.count(address) != 0; }
+    const PioneerInfo* find(const OnionAddress& address) const;
+    std::vector<std::string> addresses() const;     // canonical text, for URLs
+};
+
+// The client's set of known pioneers.
+// Reads are a single atomic shared_ptr load, no lock. Writers are
+// serialized, copy the current snapshot, edit the copy and publish it.
+// save() writes a snapshot to disk holding only the file lock.
+class PioneerDirectory {
+public:
+    static constexpr int64_t LAST_SEEN_STEP_S = 60;    // last_seen moves in steps this long
+
+    PioneerDirectory();
+
+    std::shared_ptr<const PioneerSnapshot> snapshot() const;
+    size_t size() const { return snapshot()->size(); }
+
+    // Adds and removes in one step, true if anything changed. An empty
+    // `source` keeps the current one.
+    bool merge(const std::vector<OnionAddress>& added,
+               const std::vector<OnionAddress>& removed = {},
+               const std::string& source = "");
+
+    // Applies one round of gate syncs to the per-gate lists. A full sync
+    // replaces that gate's list. A pioneer is removed only when a gate drops
+    // it and no gate's current list, nor any gate this round, still has it.
+    // Bits outside `live` belong to gates that are gone and are cleared.
+    bool apply_gate_syncs(const std::vector<GateSync>& syncs, uint64_t live,
+                          const std::string& source = "");
+
+    // Replaces the whole list, the text overload drops invalid addresses
+    void reset(const std::vector<std::string>& list, const std::string& source);
+    void reset(const std::vector<PioneerInfo>& list, const std::string& source);
+
+    // Stamps last_seen on the pioneers that just answered and refreshes
+    // every score from HostHealth. Publishes nothing and returns false when
+    // that changes no pioneer, so there is nothing to save either.
+    bool refresh_health(const std::vector<OnionAddress>& answered);
+
+    // Persists the current snapshot to the NodeStore, skipped when a newer
+    // version is already on disk
+    bool save();
+
+private:
+    void publish(std::shared_ptr<PioneerSnapshot> next);
+
+    std::atomic<std::shared_ptr<const PioneerSnapshot>> current_;
+    std::mutex write_mtx_;                              // one writer at a time
+    std::mutex save_mtx_;                               // one file write at a time
+    uint64_t saved_version_ = 0;
+};
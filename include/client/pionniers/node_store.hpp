@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <array>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "client/pionniers/directory.hpp"
+
+// Last directory version seen from a gate (for delta sync)
+struct GateCursor {
+    uint64_t epoch = 0;
+    uint64_t version = 0;
+    int slot = -1;              // bit in PioneerInfo::gates, -1 = none yet
+};
+
+// Known gates and pioneers with their metadata in one binary file
+// (Config::NODES_FILE), replacing pioneers.json and gates.txt.
+//
+// Layout, little endian, fixed width so it can be read in place:
+//   [0, 64)    header slot A
+//   [64, 128)  header slot B
+//   [128, ...) records, RECORD_SIZE bytes each
+// Header: "TSPNODE1" | u32 format | u32 record size | u64 generation |
+//         u64 record count | u32 crc32 of the preceding bytes
+// Record: u32 crc32 of the rest | u8 kind | u8 flags | u16 address length |
+//         u64 field[3] | char address[64]
+// Fields: gate     epoch | version | slot + 1 (0 = none)
+//         pioneer  f64 score | i64 last seen | gate bits
+//
+// Records are a log: a change appends a new version of the node (or a
+// removal marker), the last version of each node wins. A commit appends the
+// records and fsyncs them, then writes the header with the next generation
+// into the slot the current one is not in and fsyncs again. Until that
+// header is on the disk the new records do not count, so a crash leaves the
+// previous commit intact. When most records are superseded the file is
+// rewritten to a fresh one: written and fsynced under a temporary name,
+// renamed over the old one, then the directory is fsynced. The state in
+// memory only changes once the file has it.
+class NodeStore {
+public:
+    static constexpr uint32_t FORMAT = 2;
+    static constexpr size_t HEADER_SIZE = 64;
+    static constexpr size_t RECORD_SIZE = 96;
+    static constexpr size_t MAX_ADDRESS = 64;
+
+    enum Kind : uint8_t { GATE = 1, PIONEER = 2 };
+
+    static NodeStore& instance();
+
+    // Reads the last committed state, false if there is no usable file
+    bool load(std::vector<std::string>& gates, std::vector<PioneerInfo>& pioneers);
+
+    // Brings one kind of node on disk in line with `nodes`, writing only
+    // what changed, and commits. Gates that stay keep their cursor.
+    bool commit_gates(const std::vector<std::string>& gates);
+    bool commit_pioneers(const std::vector<PioneerInfo>& pioneers);
+
+    // Delta sync position per known gate. Cursors of gates the store does
+    // not list are ignored.
+    std::map<std::string, GateCursor> gate_cursors();
+    bool commit_gate_cursors(const std::map<std::string, GateCursor>& cursors);
+
+    NodeStore(const NodeStore&) = delete;
+    NodeStore& operator=(const NodeStore&) = delete;
+
+private:
+    using Fields = std::array<uint64_t, 3>;
+    struct Node {
+        Fields field{};
+        size_t order = 0;           // position in the list it was committed with
+    };
+    using Key = std::pair<uint8_t, std::string>;
+    using Image = std::map<Key, Node>;
+
+    NodeStore() = default;
+
+    bool load_locked();
+    bool commit_locked(Kind kind, const std::vector<std::pair<std::string, Fields>>& nodes);
+    bool rewrite_locked(Image image);
+
+    std::mutex mtx_;
+    bool loaded_ = false;
+    bool present_ = false;          // a committed state was found on load
+    bool file_ok_ = false;          // header and records on disk are usable
+    Image nodes_;                   // committed state
+    uint64_t generation_ = 0;
+    uint64_t record_count_ = 0;
+    int active_slot_ = 0;
+};
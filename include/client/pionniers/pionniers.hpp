@@ -18,20 +18,34 @@
 #pragma once
 #include <string>
 #include <vector>
-#include <mutex>
+#include <map>
+#include <cstdint>
 
-extern std::recursive_mutex pioneers_mutex;
+#include "utils/onion/onion_address.hpp"
 
-// Parse pioneers from various formats
-std::vector<std::string> parse_pioneers_from_string(const std::string& input);
-std::vector<std::string> parse_lines(const std::string& input);
+// Parse pioneers from various formats, invalid addresses are skipped
+std::vector<OnionAddress> parse_pioneers_from_string(const std::string& input);
+std::vector<OnionAddress> parse_lines(const std::string& input);
 
-// File operations
+#include "client/pionniers/directory.hpp"
+#include "client/pionniers/node_store.hpp"
+#include "client/async/task.hpp"
+
+// Persistence through the NodeStore, the old pioneers.json / gates.txt are
+// only read when there is no store yet
 bool save_pioneers_file();
-std::vector<std::string> load_pioneers_file();
+std::vector<PioneerInfo> load_pioneers_file();
+std::vector<std::string> load_gates_file();
+bool save_gates_file(const std::vector<std::string>& list);
+
+// Last directory version seen per gate (for delta sync), kept in the
+// NodeStore next to the gate itself
+std::map<std::string, GateCursor> load_gate_versions();
+bool save_gate_versions(const std::map<std::string, GateCursor>& cursors);
+void reset_gate_versions();
 
 // Load from command line arguments
 void load_gates_from_argv(int argc, char* argv[]);
 
 // Update pioneers from gates
-bool update_pioneers_from_gates();
+Task<bool> update_pioneers_from_gates();
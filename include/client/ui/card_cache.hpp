@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+#include "client/feed/feed.hpp"
+#include "client/ui/ui.hpp"
+
+// Built post cards, reused from frame to frame. A card depends on the post
+// text, its position in the feed and the width it is wrapped to. Entries are
+// keyed by position and checked against the post hash, a new width drops
+// them all. Past CAPACITY the least recently shown card goes, so a redraw
+// of an unchanged feed only moves list nodes around.
+class PostCardCache {
+public:
+    static constexpr size_t CAPACITY = 512;
+
+    const PostCard& get(const FeedPost& post, size_t index, int width);
+    void clear();
+
+private:
+    struct Entry {
+        size_t index;
+        uint64_t hash;
+        PostCard card;
+    };
+
+    int width_ = 0;
+    std::list<Entry> lru_;      // most recently shown first
+    std::unordered_map<size_t, std::list<Entry>::iterator> by_index_;
+};
@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <ftxui/component/event.hpp>
+#include <ftxui/dom/elements.hpp>
+#include <ftxui/screen/box.hpp>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+using namespace ftxui;
+
+// Virtualized feed list. Each frame builds only the cards that fit in the
+// viewport, plus OVERSCAN more below in case it grew since the last layout,
+// so a frame costs the same for ten posts or ten thousand. The scroll
+// position lives here rather than in the elements and stays put when new
+// posts are appended.
+class FeedView {
+public:
+    static constexpr size_t OVERSCAN = 2;
+    static constexpr int FALLBACK_ROWS = 24;    // viewport before the first layout
+    static constexpr int FALLBACK_COLUMNS = 80;
+
+    using CardFn = std::function<Element(size_t index)>;
+    using HeightFn = std::function<int(size_t index)>;     // rows of a card
+
+    Element render(size_t count, const CardFn& card, const HeightFn& height);
+
+    // PageUp/PageDown, Home/End and the mouse wheel, true if handled
+    bool on_event(Event event, size_t count, const HeightFn& height);
+
+    // "12-19 of 3000", empty for an empty feed
+    std::string position(size_t count) const;
+
+    // Width of the viewport in the last frame, what cards are laid out for
+    int width() const;
+
+private:
+    int viewport_rows() const;
+    // Smallest first card that still fills the viewport down to the last one
+    size_t max_first(size_t count, const HeightFn& height) const;
+
+    size_t first_ = 0;
+    size_t shown_ = 0;          // cards fully visible in the last frame
+    Box box_{0, 0, 0, -1};      // viewport of the last frame, set by reflect()
+};
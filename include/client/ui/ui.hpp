@@ -19,13 +19,24 @@
 #include <ftxui/dom/elements.hpp>
 #include <ftxui/component/component.hpp>
 #include <string>
+#include <cstddef>
 #include <functional>
 
 using namespace ftxui;
 
 Element cyber_banner();
 Element loading_screen(int progress, int frame);
-Element post_card(const std::string& post, int index);
+
+// Longer posts are cut, with a note of how much is left out
+constexpr size_t POST_CARD_MAX_LINES = 20;
+
+struct PostCard {
+    Element element;
+    int height;         // rows, border included
+};
+
+// Card for the post at `index`, the text wrapped to fit `width` columns
+PostCard post_card(const std::string& post, int index, int width);
 Element gate_input_banner();
 
 Component create_gate_input_component(
@@ -13,7 +13,9 @@
 #include <sstream>
 #include <fstream>
 #include <filesystem>
+#include <unordered_set>
 #include "utils/base64.hpp"
+#include "utils/onion/onion_address.hpp"
 
 namespace fs = std::filesystem;
 
@@ -24,21 +26,9 @@ public:
         
         try {
             std::vector<unsigned char> decoded_bytes = base64::decode(base64_input);
-            
-            std::string decoded(decoded_bytes.begin(), decoded_bytes.end());
-            
-            std::istringstream stream(decoded);
-            std::string line;
-            
-            while (std::getline(stream, line)) {
-                line.erase(0, line.find_first_not_of(" \t\r\n"));
-                line.erase(line.find_last_not_of(" \t\r\n") + 1);
-                
-                if (!line.empty() && line.find(".onion") != std::string::npos) {
-                    gates.push_back(line);
-                }
-            }
-            
+            std::istringstream stream(std::string(decoded_bytes.begin(), decoded_bytes.end()));
+            gates = parseLines(stream);
+
         } catch (const std::exception& e) {
             throw std::runtime_error("Failed to parse gates from base64: " + std::string(e.what()));
         }
@@ -55,9 +45,7 @@ public:
             }
         }
 
-        std::vector<unsigned char> bytes(combined.begin(), combined.end());
-        
-        return base64::encode(bytes);
+        return base64::encode(combined);
     }
 
     static void saveToFile(const std::vector<std::string>& gates, const std::string& filepath) {
@@ -86,17 +74,29 @@ public:
             return gates;
         }
         
+        gates = parseLines(file);
+
+        file.close();
+        return gates;
+    }
+
+private:
+    // One address per line, anything that is not a valid v3 address is
+    // skipped, duplicates are dropped. Addresses come back in canonical form.
+    static std::vector<std::string> parseLines(std::istream& in) {
+        std::vector<std::string> gates;
+        std::unordered_set<OnionAddress> seen;
+
         std::string line;
-        while (std::getline(file, line)) {
+        while (std::getline(in, line)) {
             line.erase(0, line.find_first_not_of(" \t\r\n"));
             line.erase(line.find_last_not_of(" \t\r\n") + 1);
-            
-            if (!line.empty() && line.find(".onion") != std::string::npos) {
-                gates.push_back(line);
+
+            auto onion = OnionAddress::parse(line);
+            if (onion && seen.insert(*onion).second) {
+                gates.push_back(onion->to_string());
             }
         }
-        
-        file.close();
         return gates;
     }
 };
\ No newline at end of file
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "gate/registry/registry.hpp"
+
+// Body of POST /gossip and of its response:
+//   "gossip <sender origin>\n"
+//   "vv <origin> <seq>\n"                      one per known origin
+//   "c <origin> <seq> <stamp> <+|-><address>\n" one per change
+struct GossipMessage {
+    uint64_t sender = 0;
+    VersionVector vv;
+    std::vector<GossipChange> changes;
+};
+
+std::string encode_gossip(const GossipMessage& msg);
+bool decode_gossip(const std::string& body, GossipMessage& msg);
+
+// Log sink, same types as the gate's log: 0 = info, 1 = success, 2 = error
+using FederationLog = std::function<void(const std::string&, int)>;
+
+// Anti-entropy between gates: every round each peer gets one POST /gossip
+// with our version vector and the changes it has not seen yet, and answers
+// with the changes we have not seen. Local changes trigger an early round
+// after a short batching window.
+//
+// Gates of one federation share a secret (data/gate_secret.txt), sent as
+// the X-Gossip-Key header. Only the peer onions are ever contacted, so
+// answers are trusted; requests without the key are refused.
+class GateFederation {
+public:
+    static constexpr size_t BATCH_LIMIT = 2000;
+    static constexpr std::chrono::seconds ROUND_INTERVAL{30};
+    static constexpr std::chrono::seconds BATCH_WINDOW{2};
+    static constexpr size_t MIN_SECRET_SIZE = 32;
+    static constexpr const char* KEY_HEADER = "X-Gossip-Key";
+
+    GateFederation(PionnierRegistry& registry, std::vector<std::string> peers, std::string secret,
+                   int socks_port, FederationLog log = nullptr);
+    ~GateFederation();
+
+    void start();
+    void stop();
+
+    // Wakes the worker for an early round (after local changes)
+    void notify();
+
+    // Whether an incoming request carries our secret
+    bool authorized(std::string_view key) const;
+
+    // Handles an incoming POST /gossip body, returns the response body
+    std::string handle_gossip(const std::string& body);
+
+    size_t peer_count() const { return peers_.size(); }
+
+private:
+    void run();
+    bool gossip_with(const std::string& peer);
+    void log(const std::string& msg, int type) const;
+
+    PionnierRegistry& registry_;
+    std::vector<std::string> peers_;
+    std::string secret_;
+    std::string proxy_;
+    FederationLog log_;
+
+    std::map<std::string, VersionVector> peer_vv_;  // last vector each peer reported
+
+    std::thread worker_;
+    std::atomic<bool> running_{false};
+    std::mutex wake_mtx_;
+    std::condition_variable wake_cv_;
+    bool pending_ = false;
+};
+
+std::vector<std::string> load_gate_peers(const std::string& filepath);
+
+// First line of the file, empty when missing or shorter than MIN_SECRET_SIZE
+std::string load_gate_secret(const std::string& filepath);
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <unordered_set>
+#include <unordered_map>
+
+#include "utils/onion/onion_address.hpp"
+
+// One add/remove in the registry history
+struct RegistryChange {
+    uint64_t version;
+    bool added;
+    OnionAddress address;
+};
+
+// Change as exchanged between federated gates.
+// origin/seq identify who made it, stamp (Lamport clock) orders
+// concurrent changes of the same address: higher (stamp, origin) wins.
+struct GossipChange {
+    uint64_t origin;
+    uint64_t seq;
+    uint64_t stamp;
+    bool added;
+    OnionAddress address;
+};
+
+// origin -> highest seq seen from that origin
+using VersionVector = std::map<uint64_t, uint64_t>;
+
+// Versioned set of registered pionniers.
+// Every effective add/remove bumps the version and is kept in a bounded
+// change log, so clients can ask only for what changed since their version.
+// The epoch changes whenever history is lost (fresh registry), which tells
+// clients that their version is meaningless and a full resync is needed.
+//
+// For federation every address also keeps the last change that touched it
+// (removals stay as tombstones), so a peer can be sent exactly the state it
+// has not seen yet according to its version vector. The epoch doubles as
+// this gate's origin id.
+//
+// With storage opened the state lives in <dir>/registry.snap plus an append
+// only <dir>/registry.journal of every entry change since that snapshot.
+// Startup loads the snapshot, replays the journal and compacts both into a
+// fresh snapshot, so the epoch and versions survive restarts.
+//
+// Compaction sets the journal aside as registry.journal.old and starts a new
+// one under the lock, then writes the snapshot outside it: temp file, fsync,
+// rename, fsync of the directory, and only then drops the old journal.
+// Replay skips changes the snapshot already has, so a crash anywhere in
+// between loses nothing.
+class PionnierRegistry {
+public:
+    static constexpr size_t MAX_HISTORY = 4096;
+    static constexpr size_t JOURNAL_COMPACT_AT = 16384;
+
+    PionnierRegistry();
+
+    // Loads persisted state from `dir` and journals every change from now on
+    bool open_storage(const std::filesystem::path& dir);
+
+    bool add(const OnionAddress& address);
+    bool remove(const OnionAddress& address);
+
+    // Adds all addresses under one lock, readers see either none or all of
+    // them. Returns how many were new.
+    size_t add_batch(const std::vector<OnionAddress>& addresses);
+
+    uint64_t epoch() const;
+    uint64_t version() const;
+    size_t size() const;
+    std::vector<OnionAddress> snapshot() const;
+
+    // Fills `out` with changes newer than `since`. Returns false when the
+    // history no longer reaches back that far (or the epoch does not match)
+    // and the caller has to send the full list instead.
+    bool changes_since(uint64_t since_epoch, uint64_t since,
+                       std::vector<RegistryChange>& out) const;
+
+    // Text body of /get_pionniers?since=...:
+    //   "<full|delta> <epoch> <version>\n" followed by "+addr\n" / "-addr\n"
+    std::string render_since(uint64_t since_epoch, uint64_t since) const;
+
+    // Marks the gate as holding the federated (whole network) directory,
+    // announced to clients in the /get_pionniers?since= header
+    void set_federated(bool federated);
+
+    // ---- Federation ----
+    uint64_t origin_id() const { return epoch(); }
+    VersionVector version_vector() const;
+
+    // Changes a peer with version vector `peer_vv` has not seen, ordered by
+    // (origin, seq) so a truncated batch still leaves a valid vector behind
+    std::vector<GossipChange> changes_for(const VersionVector& peer_vv, size_t limit) const;
+
+    // Merges changes received from a peer, returns how many changed membership.
+    // A change stamped more than MAX_CLOCK_LEAD ahead of our clock is refused
+    // with the rest of its origin's batch, so the clock can never be pushed
+    // to where clock_ + 1 overflows.
+    size_t apply_remote(const std::vector<GossipChange>& changes);
+
+    static constexpr uint64_t MAX_CLOCK_LEAD = 1ull << 32;
+
+private:
+    struct EntryState {
+        uint64_t origin;
+        uint64_t seq;
+        uint64_t stamp;
+        bool alive;
+    };
+
+    bool apply_local(bool added, const OnionAddress& address);
+    bool apply_local_locked(bool added, const OnionAddress& address);
+    void set_state(const OnionAddress& address, const EntryState& st);
+    void set_membership(bool added, const OnionAddress& address);
+
+    bool load_snapshot_locked(const std::filesystem::path& path);
+    void replay_journal_locked(const std::filesystem::path& path);
+    std::string render_snapshot_locked() const;
+    bool write_snapshot(const std::string& data) const;
+
+    // Flushes the journal. When it is due for compaction sets it aside and
+    // renders the state into `snapshot` for compact(), which the caller
+    // runs after dropping the lock.
+    void flush_journal_locked(std::string& snapshot);
+    void compact(const std::string& snapshot);
+
+    bool changes_since_locked(uint64_t since_epoch, uint64_t since,
+                              std::vector<RegistryChange>& out) const;
+    void record(bool added, const OnionAddress& address);
+
+    mutable std::mutex mtx_;
+    std::vector<OnionAddress> entries_;       // registration order, for the UI
+    std::unordered_set<OnionAddress> members_;
+    std::deque<RegistryChange> history_;
+    uint64_t epoch_ = 0;
+    uint64_t version_ = 0;
+    uint64_t history_floor_ = 0;              // oldest version still answerable
+    bool federated_ = false;
+
+    std::unordered_map<OnionAddress, EntryState> states_;
+    VersionVector vv_;
+    uint64_t local_seq_ = 0;
+    uint64_t clock_ = 0;
+
+    std::filesystem::path storage_dir_;
+    std::ofstream journal_;
+    size_t journal_entries_ = 0;
+    bool compacting_ = false;                 // a snapshot is being written
+    bool old_journal_ = false;                // set aside, not in a snapshot yet
+};
+
+// Parses a POST /add_pionniers body (one address per line, blank lines
+// ignored) in a single pass. On the first line that is not a valid v3
+// address returns false with `error` describing it, and `out` must be
+// discarded.
+bool parse_onion_batch(std::string_view body, std::vector<OnionAddress>& out, std::string& error);
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// POST /add_posts body: one frame per post, "<length>\n<post bytes>\n".
+// Length prefixes keep posts free to contain anything, newlines included.
+constexpr size_t MAX_POST_SIZE = 1 << 20;
+constexpr size_t MAX_BATCH_POSTS = 1000;
+
+// Splits a batch body into posts (views into `body`). False with a reason
+// in `error` for a malformed body, a frame longer than MAX_POST_SIZE or
+// more than MAX_BATCH_POSTS frames; nothing of such a batch is stored.
+bool parse_post_batch(std::string_view body, std::vector<std::string_view>& out, std::string& error);
@@ -16,57 +16,62 @@
  */
 
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
+// Standard base64 (RFC 4648, "+/" alphabet, "=" padding).
+// Bulk work runs on AVX2 or SSSE3 when the CPU has them, picked once at
+// startup, with a scalar fallback. Decoding is strict: characters outside
+// the alphabet, misplaced padding, non-zero trailing bits and truncated
+// input are errors. ASCII whitespace (line breaks of pasted codes) is skipped.
 namespace base64 {
 
-inline std::string encode(const std::vector<unsigned char>& data) {
-    static const char table[] =
-        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-    std::string out;
-    unsigned int val = 0;
-    int valb = -6;
+// Output sizes, exact for canonical input without whitespace
+inline size_t encoded_size(size_t n) { return (n + 2) / 3 * 4; }
+size_t decoded_size(std::string_view in);
 
-    for (unsigned char c : data) {
-        val = (val << 8) + c;
-        valb += 8;
-        while (valb >= 0) {
-            out.push_back(table[(val >> valb) & 0x3F]);
-            valb -= 6;
-        }
-    }
-    if (valb > -6)
-        out.push_back(table[((val << 8) >> (valb + 8)) & 0x3F]);
-    while (out.size() % 4)
-        out.push_back('=');
-    return out;
-}
+// Incremental encoder, output is appended to `out`
+class Encoder {
+public:
+    void update(const void* data, size_t n, std::string& out);
+    void finish(std::string& out);
 
-inline std::vector<unsigned char> decode(const std::string& str) {
-    static const int table[256] = {
-        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,
-        -1,-1,-1,-1,-1,-1,-1,-1,-1,-1,-1,62,-1,-1,-1,63,
-        52,53,54,55,56,57,58,59,60,61,-1,-1,-1, 0,-1,-1,
-        -1, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,10,11,12,13,14,
-        15,16,17,18,19,20,21,22,23,24,25,-1,-1,-1,-1,-1,
-        -1,26,27,28,29,30,31,32,33,34,35,36,37,38,39,40,
-        41,42,43,44,45,46,47,48,49,50,51
-    };
-    std::vector<unsigned char> out;
-    int val = 0, valb = -8;
-    for (unsigned char c : str) {
-        int code = table[c];
-        if (code == -1) break;
-        val = (val << 6) + code;
-        valb += 6;
-        if (valb >= 0) {
-            out.push_back((val >> valb) & 0xFF);
-            valb -= 8;
-        }
-    }
-    return out;
-}
+private:
+    uint8_t pending_[3] = {};
+    size_t npending_ = 0;
+};
+
+// Incremental decoder, output is appended to `out`. Once update() or
+// finish() returned false the decoder stays failed, error() says why.
+class Decoder {
+public:
+    bool update(std::string_view in, std::vector<unsigned char>& out);
+    bool finish();
+
+    const std::string& error() const { return error_; }
+
+private:
+    bool fail(const std::string& what);
 
-} 
+    uint8_t quad_[4] = {};
+    size_t nquad_ = 0;
+    size_t padding_ = 0;        // '=' seen in the current quad
+    bool done_ = false;         // final padded quad consumed
+    size_t position_ = 0;       // characters consumed so far
+    std::string error_;
+};
+
+std::string encode(const void* data, size_t n);
+inline std::string encode(std::string_view data) { return encode(data.data(), data.size()); }
+inline std::string encode(const std::vector<unsigned char>& data) { return encode(data.data(), data.size()); }
+
+// False with `error` set on malformed input, `out` is left empty then
+bool decode(std::string_view in, std::vector<unsigned char>& out, std::string& error);
+
+// Throws std::invalid_argument on malformed input
+std::vector<unsigned char> decode(std::string_view in);
+
+}
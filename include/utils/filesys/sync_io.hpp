@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cerrno>
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Writes that are on the disk once they return true: everything goes through
+// the OS file API and is followed by fsync (_commit on Windows).
+namespace sync_io
+{
+    // File opened for writing, created if missing
+    class File {
+    public:
+        File() = default;
+        ~File() { close(); }
+
+        File(const File&) = delete;
+        File& operator=(const File&) = delete;
+
+        bool open(const std::filesystem::path& path, bool truncate = false) {
+            close();
+#ifdef _WIN32
+            fd_ = _wopen(path.c_str(), _O_RDWR | _O_CREAT | _O_BINARY | (truncate ? _O_TRUNC : 0),
+                         _S_IREAD | _S_IWRITE);
+#else
+            fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+#endif
+            return fd_ >= 0;
+        }
+
+        bool is_open() const { return fd_ >= 0; }
+
+        bool write_at(uint64_t offset, std::string_view data) {
+            if (fd_ < 0) return false;
+#ifdef _WIN32
+            if (_lseeki64(fd_, static_cast<__int64>(offset), SEEK_SET) < 0) return false;
+            return write_all(data);
+#else
+            for (size_t off = 0; off < data.size();) {
+                ssize_t n = ::pwrite(fd_, data.data() + off, data.size() - off,
+                                     static_cast<off_t>(offset + off));
+                if (n > 0) off += static_cast<size_t>(n);
+                else if (n < 0 && errno != EINTR) return false;
+            }
+            return true;
+#endif
+        }
+
+        bool append(std::string_view data) {
+            if (fd_ < 0) return false;
+#ifdef _WIN32
+            if (_lseeki64(fd_, 0, SEEK_END) < 0) return false;
+#else
+            if (::lseek(fd_, 0, SEEK_END) < 0) return false;
+#endif
+            return write_all(data);
+        }
+
+        bool sync() {
+            if (fd_ < 0) return false;
+#ifdef _WIN32
+            return _commit(fd_) == 0;
+#else
+            return ::fsync(fd_) == 0;
+#endif
+        }
+
+        void close() {
+            if (fd_ < 0) return;
+#ifdef _WIN32
+            _close(fd_);
+#else
+            ::close(fd_);
+#endif
+            fd_ = -1;
+        }
+
+    private:
+        bool write_all(std::string_view data) {
+            for (size_t off = 0; off < data.size();) {
+#ifdef _WIN32
+                int n = _write(fd_, data.data() + off, static_cast<unsigned>(data.size() - off));
+#else
+                ssize_t n = ::write(fd_, data.data() + off, data.size() - off);
+#endif
+                if (n > 0) off += static_cast<size_t>(n);
+                else if (n < 0 && errno != EINTR) return false;
+            }
+            return true;
+        }
+
+        int fd_ = -1;
+    };
+
+    // Replaces the contents of `path` with `data`
+    inline bool write_file(const std::filesystem::path& path, std::string_view data) {
+        File f;
+        return f.open(path, true) && f.write_at(0, data) && f.sync();
+    }
+
+    // Makes a rename inside `dir` durable. NTFS journals renames itself.
+    inline bool sync_dir(const std::filesystem::path& dir) {
+#ifdef _WIN32
+        (void)dir;
+        return true;
+#else
+        int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd < 0) return false;
+        bool ok = ::fsync(fd) == 0;
+        ::close(fd);
+        return ok;
+#endif
+    }
+}
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+
+// HTTP/1.1 server for the hidden service port. A connection serves requests
+// until the client sends "Connection: close", closes it, or leaves it idle
+// for IDLE_TIMEOUT, so a client reusing its circuit saves the Tor stream
+// setup on every request after the first.
+// Everything runs on the thread that calls run(): handlers are called one
+// at a time and need no locking among themselves.
+class HttpServer {
+public:
+    using Request = boost::beast::http::request<boost::beast::http::string_body>;
+    using Response = boost::beast::http::response<boost::beast::http::string_body>;
+    using Handler = std::function<void(const Request&, Response&)>;
+
+    static constexpr std::chrono::seconds IDLE_TIMEOUT{30};
+
+    HttpServer(unsigned short port, Handler handler)
+        : acceptor_(ioc_, {boost::asio::ip::tcp::v4(), port}), handler_(std::move(handler)) {}
+
+    // Serves until stop()
+    void run() {
+        accept();
+        ioc_.run();
+    }
+
+    // From any thread, open connections are dropped
+    void stop() { ioc_.stop(); }
+
+private:
+    class Session : public std::enable_shared_from_this<Session> {
+    public:
+        Session(boost::asio::ip::tcp::socket socket, const Handler& handler)
+            : stream_(std::move(socket)), handler_(handler) {}
+
+        void read() {
+            req_ = {};
+            stream_.expires_after(IDLE_TIMEOUT);
+            boost::beast::http::async_read(stream_, buffer_, req_,
+                [self = shared_from_this()](boost::beast::error_code ec, size_t) {
+                    if (ec) return self->close();
+                    self->respond();
+                });
+        }
+
+    private:
+        void respond() {
+            res_ = {};
+            res_.version(req_.version());
+            res_.keep_alive(req_.keep_alive());
+            handler_(req_, res_);
+
+            boost::beast::http::async_write(stream_, res_,
+                [self = shared_from_this()](boost::beast::error_code ec, size_t) {
+                    if (ec || !self->res_.keep_alive()) return self->close();
+                    self->read();
+                });
+        }
+
+        void close() {
+            boost::beast::error_code ec;
+            stream_.socket().shutdown(boost::asio::ip::tcp::socket::shutdown_send, ec);
+        }
+
+        boost::beast::tcp_stream stream_;
+        boost::beast::flat_buffer buffer_;
+        const Handler& handler_;
+        Request req_;
+        Response res_;
+    };
+
+    void accept() {
+        acceptor_.async_accept([this](boost::beast::error_code ec, boost::asio::ip::tcp::socket socket) {
+            if (!ec) std::make_shared<Session>(std::move(socket), handler_)->read();
+            accept();
+        });
+    }
+
+    boost::asio::io_context ioc_{1};
+    boost::asio::ip::tcp::acceptor acceptor_;
+    Handler handler_;
+};
@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// v3 onion service address in its binary form: the 35 bytes behind the 56
+// base32 characters (ed25519 key 32 | checksum 2 | version 1).
+// parse() accepts an address only if it decodes and its checksum
+// (SHA3-256 of ".onion checksum" | key | version) matches, so typos and
+// garbage never get into a directory. Comparison is a memcmp, hashing reads
+// 8 bytes of the key, which is uniformly random already.
+class OnionAddress {
+public:
+    static constexpr size_t SIZE = 35;
+    static constexpr size_t ENCODED_SIZE = 56;
+    static constexpr uint8_t VERSION = 3;
+
+    OnionAddress() = default;
+
+    // "<56 base32 chars>" with or without ".onion", any case
+    static std::optional<OnionAddress> parse(std::string_view text);
+    static bool is_valid(std::string_view text) { return parse(text).has_value(); }
+
+    // Canonical lower case form, "<56 chars>.onion"
+    std::string to_string() const;
+
+    const std::array<uint8_t, SIZE>& bytes() const { return bytes_; }
+
+    size_t hash() const {
+        uint64_t h;
+        std::memcpy(&h, bytes_.data(), sizeof(h));
+        return static_cast<size_t>(h);
+    }
+
+    bool operator==(const OnionAddress& o) const { return bytes_ == o.bytes_; }
+    bool operator!=(const OnionAddress& o) const { return bytes_ != o.bytes_; }
+    bool operator<(const OnionAddress& o) const { return bytes_ < o.bytes_; }
+
+private:
+    std::array<uint8_t, SIZE> bytes_{};
+};
+
+namespace std {
+template <>
+struct hash<OnionAddress> {
+    size_t operator()(const OnionAddress& a) const noexcept { return a.hash(); }
+};
+}
+
+// SHA3-256 (FIPS 202), used for the onion address checksum
+std::array<uint8_t, 32> sha3_256(const uint8_t* data, size_t len);
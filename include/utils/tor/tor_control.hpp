@@ -0,0 +1,308 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef TOR_CONTROL_HPP
+#define TOR_CONTROL_HPP
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Where Tor is in its bootstrap, from a BOOTSTRAP status line
+struct TorBootstrap {
+    int progress = 0;           // 0..100
+    std::string tag;            // "conn_or", "done", ...
+    std::string summary;
+    bool warning = false;       // WARN severity: a problem, Tor keeps trying
+};
+
+// Parses "... BOOTSTRAP PROGRESS=50 TAG=... SUMMARY="..."", as found in
+// STATUS_CLIENT events and in GETINFO status/bootstrap-phase
+inline std::optional<TorBootstrap> parse_tor_bootstrap(const std::string& line) {
+    size_t at = line.find(" BOOTSTRAP ");
+    if (at == std::string::npos) return std::nullopt;
+
+    auto value = [&](const std::string& key) -> std::string {
+        size_t k = line.find(" " + key + "=", at);
+        if (k == std::string::npos) return "";
+        size_t v = k + key.size() + 2;
+        if (v < line.size() && line[v] == '"') {
+            size_t end = line.find('"', v + 1);
+            return line.substr(v + 1, end == std::string::npos ? std::string::npos : end - v - 1);
+        }
+        return line.substr(v, line.find(' ', v) - v);
+    };
+
+    TorBootstrap status;
+    try {
+        status.progress = std::stoi(value("PROGRESS"));
+    } catch (const std::exception&) {
+        return std::nullopt;
+    }
+    status.tag = value("TAG");
+    status.summary = value("SUMMARY");
+    // Severity is the word in front of BOOTSTRAP
+    size_t sev = at > 0 ? line.find_last_of(" =", at - 1) : std::string::npos;
+    sev = sev == std::string::npos ? 0 : sev + 1;
+    status.warning = line.compare(sev, at - sev, "WARN") == 0;
+    return status;
+}
+
+// Client for Tor's control protocol (control-spec.txt) on 127.0.0.1.
+// Commands are synchronous; asynchronous events (650 replies) that arrive
+// in between are queued for next_event().
+class TorControl {
+public:
+    struct Reply {
+        int status = 0;                     // 250 = OK
+        std::vector<std::string> lines;     // text after the status code
+
+        bool ok() const { return status == 250; }
+    };
+
+    TorControl() = default;
+    ~TorControl() { close(); }
+
+    TorControl(const TorControl&) = delete;
+    TorControl& operator=(const TorControl&) = delete;
+
+    bool connect(int port) {
+        close();
+#ifdef _WIN32
+        static const bool wsa_ready = [] {
+            WSADATA wsa;
+            return WSAStartup(MAKEWORD(2, 2), &wsa) == 0;
+        }();
+        if (!wsa_ready) return false;
+#endif
+        socket_t s = ::socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (s == INVALID_SOCK) return false;
+
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(static_cast<uint16_t>(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(s, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+            close_socket(s);
+            return false;
+        }
+        sock_ = s;
+        return true;
+    }
+
+    void close() {
+        if (sock_ != INVALID_SOCK) {
+            close_socket(sock_);
+            sock_ = INVALID_SOCK;
+        }
+        buf_.clear();
+        events_.clear();
+    }
+
+    bool connected() const { return sock_ != INVALID_SOCK; }
+
+    // Sends one command line and waits for its reply. status is 0 when the
+    // connection failed or Tor did not answer in time, which closes it.
+    Reply command(const std::string& line,
+                  std::chrono::milliseconds timeout = std::chrono::seconds(10)) {
+        Reply reply;
+        if (!send_all(line + "\r\n")) return reply;
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (auto r = read_reply(deadline)) {
+            if (r->status / 100 != 6) return *r;
+            for (auto& l : r->lines) events_.push_back(std::move(l));
+        }
+        // A late reply would be taken for the next command's
+        close();
+        return reply;
+    }
+
+    // PROTOCOLINFO, then AUTHENTICATE with the cookie file Tor names
+    bool authenticate_cookie(std::string& error) {
+        Reply info = command("PROTOCOLINFO 1");
+        if (!info.ok()) {
+            error = "PROTOCOLINFO failed";
+            return false;
+        }
+
+        std::string cookie_path;
+        for (const auto& l : info.lines) {
+            size_t k = l.find("COOKIEFILE=\"");
+            if (l.rfind("AUTH ", 0) != 0 || k == std::string::npos) continue;
+            cookie_path = unescape(l.substr(k + 12, l.rfind('"') - k - 12));
+        }
+        if (cookie_path.empty()) {
+            error = "Tor does not offer cookie authentication";
+            return false;
+        }
+
+        std::ifstream in(std::filesystem::path(cookie_path), std::ios::binary);
+        std::string cookie((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        if (cookie.size() != 32) {
+            error = "Cannot read control cookie: " + cookie_path;
+            return false;
+        }
+
+        static const char* hex = "0123456789ABCDEF";
+        std::string line = "AUTHENTICATE ";
+        for (unsigned char c : cookie) {
+            line += hex[c >> 4];
+            line += hex[c & 0x0F];
+        }
+        Reply auth = command(line);
+        if (!auth.ok()) {
+            error = "Authentication rejected: " + (auth.lines.empty() ? "no answer" : auth.lines.front());
+            return false;
+        }
+        return true;
+    }
+
+    // Value as a control-port quoted string
+    static std::string quote(const std::string& s) {
+        std::string out = "\"";
+        for (char c : s) {
+            if (c == '"' || c == '\\') out += '\\';
+            out += c;
+        }
+        return out + "\"";
+    }
+
+    // Next queued or incoming event line ("STATUS_CLIENT NOTICE ..."),
+    // nullopt on timeout or a closed connection
+    std::optional<std::string> next_event(std::chrono::milliseconds timeout) {
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        while (events_.empty()) {
+            auto r = read_reply(deadline);
+            if (!r) return std::nullopt;
+            for (auto& l : r->lines) events_.push_back(std::move(l));
+        }
+        std::string event = std::move(events_.front());
+        events_.pop_front();
+        return event;
+    }
+
+private:
+#ifdef _WIN32
+    using socket_t = SOCKET;
+    static constexpr socket_t INVALID_SOCK = INVALID_SOCKET;
+    static void close_socket(socket_t s) { closesocket(s); }
+#else
+    using socket_t = int;
+    static constexpr socket_t INVALID_SOCK = -1;
+    static void close_socket(socket_t s) { ::close(s); }
+#endif
+
+    bool send_all(const std::string& data) {
+        if (!connected()) return false;
+        size_t sent = 0;
+        while (sent < data.size()) {
+            int n = ::send(sock_, data.data() + sent, static_cast<int>(data.size() - sent), 0);
+            if (n <= 0) {
+                close();
+                return false;
+            }
+            sent += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    bool read_line(std::string& line, std::chrono::steady_clock::time_point deadline) {
+        for (;;) {
+            size_t eol = buf_.find("\r\n");
+            if (eol != std::string::npos) {
+                line = buf_.substr(0, eol);
+                buf_.erase(0, eol + 2);
+                return true;
+            }
+            if (!connected()) return false;
+
+            auto left = std::chrono::duration_cast<std::chrono::microseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (left <= 0) return false;
+
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(sock_, &readable);
+            timeval tv{static_cast<long>(left / 1000000), static_cast<long>(left % 1000000)};
+            if (::select(static_cast<int>(sock_) + 1, &readable, nullptr, nullptr, &tv) <= 0) continue;
+
+            char chunk[4096];
+            int n = ::recv(sock_, chunk, sizeof(chunk), 0);
+            if (n <= 0) {
+                close();
+                return false;
+            }
+            buf_.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+    // One complete reply: "250-..." lines up to "250 ...", with "250+..."
+    // data blocks (up to a lone ".") folded into their line
+    std::optional<Reply> read_reply(std::chrono::steady_clock::time_point deadline) {
+        Reply reply;
+        std::string line;
+        while (read_line(line, deadline)) {
+            if (line.size() < 4) continue;
+            reply.status = std::atoi(line.substr(0, 3).c_str());
+            std::string text = line.substr(4);
+
+            if (line[3] == '+') {
+                std::string data;
+                while (read_line(data, deadline) && data != ".") {
+                    text += "\n" + (data.rfind("..", 0) == 0 ? data.substr(1) : data);
+                }
+            }
+            reply.lines.push_back(std::move(text));
+            if (line[3] == ' ') return reply;
+        }
+        return std::nullopt;
+    }
+
+    // Undoes the C-style escapes of a quoted control-port string
+    static std::string unescape(const std::string& s) {
+        std::string out;
+        for (size_t i = 0; i < s.size(); ++i) {
+            if (s[i] == '\\' && i + 1 < s.size()) ++i;
+            out += s[i];
+        }
+        return out;
+    }
+
+    socket_t sock_ = INVALID_SOCK;
+    std::string buf_;
+    std::deque<std::string> events_;
+};
+
+#endif
@@ -0,0 +1,126 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef TOR_HOST_LOCK_HPP
+#define TOR_HOST_LOCK_HPP
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+#include <filesystem>
+#include <string>
+
+// Advisory lock on a file, shared between the processes of this host. The
+// system drops it when its holder exits, crashed or not.
+class TorHostLock {
+public:
+    // One lock per name and control port, in the temp directory, so every
+    // role that can reach the same Tor finds it
+    TorHostLock(const std::string& name, int control_port)
+        : path_(std::filesystem::temp_directory_path() /
+                ("torsper-" + std::to_string(control_port) + "-" + name + ".lock")) {}
+
+    ~TorHostLock() {
+        unlock();
+        close_file();
+    }
+
+    TorHostLock(const TorHostLock&) = delete;
+    TorHostLock& operator=(const TorHostLock&) = delete;
+
+    // Block until held, false when the lock file cannot be opened
+    bool lock() { return acquire(true, true); }
+    bool lock_shared() { return acquire(false, true); }
+
+    // Exclusive, only if nobody else holds it in any mode
+    bool try_lock() { return acquire(true, false); }
+
+    void unlock() {
+        if (!held_) return;
+#ifdef _WIN32
+        OVERLAPPED ov{};
+        UnlockFileEx(file_, 0, 1, 0, &ov);
+#else
+        ::flock(fd_, LOCK_UN);
+#endif
+        held_ = false;
+    }
+
+    bool held() const { return held_; }
+
+private:
+#ifdef _WIN32
+    bool open_file() {
+        if (file_ != INVALID_HANDLE_VALUE) return true;
+        file_ = CreateFileW(path_.c_str(), GENERIC_READ | GENERIC_WRITE,
+                            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr,
+                            OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+        return file_ != INVALID_HANDLE_VALUE;
+    }
+
+    void close_file() {
+        if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+        file_ = INVALID_HANDLE_VALUE;
+    }
+
+    bool acquire(bool exclusive, bool wait) {
+        unlock();
+        if (!open_file()) return false;
+        DWORD flags = (exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0) | (wait ? 0 : LOCKFILE_FAIL_IMMEDIATELY);
+        OVERLAPPED ov{};
+        held_ = LockFileEx(file_, flags, 0, 1, 0, &ov) != 0;
+        return held_;
+    }
+
+    HANDLE file_ = INVALID_HANDLE_VALUE;
+#else
+    bool open_file() {
+        if (fd_ >= 0) return true;
+        fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+        return fd_ >= 0;
+    }
+
+    void close_file() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+    bool acquire(bool exclusive, bool wait) {
+        unlock();
+        if (!open_file()) return false;
+        int op = (exclusive ? LOCK_EX : LOCK_SH) | (wait ? 0 : LOCK_NB);
+        int rc;
+        while ((rc = ::flock(fd_, op)) != 0 && errno == EINTR) {}
+        held_ = rc == 0;
+        return held_;
+    }
+
+    int fd_ = -1;
+#endif
+
+    std::filesystem::path path_;
+    bool held_ = false;
+};
+
+#endif
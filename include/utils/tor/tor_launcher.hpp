@@ -18,16 +18,26 @@
 #ifndef TOR_LAUNCHER_HPP
 #define TOR_LAUNCHER_HPP
 
-#define WIN32_LEAN_AND_MEAN
-#define NOMINMAX
-#include <windows.h>
-
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <iterator>
+#include <mutex>
 #include <string>
 #include <stdexcept>
 #include <optional>
-#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "utils/base64.hpp"
+#include "utils/tor/tor_control.hpp"
+#include "utils/tor/tor_host_lock.hpp"
+#include "utils/tor/tor_process.hpp"
 
 namespace fs = std::filesystem;
 
@@ -37,24 +47,63 @@ enum class TorMode {
 };
 
 struct TorConfig {
+    // All roles on a host meet on this port, so they share one Tor
+    static constexpr int SHARED_CONTROL_PORT = 10050;
+
     std::string name;
     int socks_port;
+    int control_port;           // cookie-authenticated
     TorMode mode;
     std::optional<int> hidden_service_port;
 
     TorConfig(const std::string& n, int sp)
-        : name(n), socks_port(sp), mode(TorMode::CLIENT_ONLY), hidden_service_port(std::nullopt) {}
+        : name(n), socks_port(sp), control_port(SHARED_CONTROL_PORT),
+          mode(TorMode::CLIENT_ONLY), hidden_service_port(std::nullopt) {}
 
     TorConfig(const std::string& n, int sp, int hs_port)
-        : name(n), socks_port(sp), mode(TorMode::HIDDEN_SERVICE), hidden_service_port(hs_port) {}
+        : name(n), socks_port(sp), control_port(SHARED_CONTROL_PORT),
+          mode(TorMode::HIDDEN_SERVICE), hidden_service_port(hs_port) {}
 };
 
+// Called from launch() for every bootstrap step Tor reports
+using TorProgressCallback = std::function<void(const TorBootstrap&)>;
+
+// Crashes and restarts seen by the supervisor, for the UI log
+using TorEventCallback = std::function<void(const std::string&)>;
+
 class TorLauncher {
+public:
+    static constexpr std::chrono::seconds CONTROL_TIMEOUT{30};
+    static constexpr std::chrono::seconds BOOTSTRAP_TIMEOUT{180};
+    static constexpr std::chrono::seconds RESTART_MIN_DELAY{1};
+    static constexpr std::chrono::seconds RESTART_MAX_DELAY{60};
+    static constexpr std::chrono::seconds STABLE_AFTER{300};  // uptime that resets the backoff
+
 private:
-    PROCESS_INFORMATION process_info_;
+    TorProcess process_;
     std::string onion_address_;
     TorConfig config_;
     fs::path exe_folder_;
+    TorControl control_;
+
+    std::atomic<bool> attached_{false};     // Tor belongs to another role on this host
+
+    // Held while the roles on this host start Tor, change its SocksPorts or
+    // decide to halt it
+    TorHostLock config_lock_;
+    // Held shared by every role using Tor: whoever gets it exclusively is
+    // the last one and may halt Tor
+    TorHostLock users_;
+
+    // Supervision, see supervise()
+    std::thread supervisor_;
+    std::mutex supervisor_mtx_;
+    std::condition_variable supervisor_cv_;
+    std::atomic<bool> stopping_{false};
+    bool crashed_ = false;
+    std::string crash_reason_;
+    std::chrono::steady_clock::time_point started_at_{};
+    TorEventCallback on_event_;
 
     fs::path get_data_dir() const {
         return exe_folder_ / "data" / config_.name;
@@ -64,24 +113,27 @@ private:
         return get_data_dir() / ("torrc_" + config_.name);
     }
 
+    // Where onion keys lived before ADD_ONION, read once to keep the address
     fs::path get_hidden_dir() const {
         return get_data_dir() / "hidden_service";
     }
 
+    fs::path get_onion_key_path() const {
+        return get_data_dir() / "onion_key";
+    }
+
+    // Shared by every role that starts Tor from this folder
     fs::path get_tor_data_dir() const {
-        return get_data_dir() / ("tor_data_" + config_.name);
+        return exe_folder_ / "data" / "tor";
     }
 
     void create_directories() {
+        fs::create_directories(get_data_dir());
         fs::create_directories(get_tor_data_dir());
-        if (config_.mode == TorMode::HIDDEN_SERVICE) {
-            fs::create_directories(get_hidden_dir());
-        }
     }
 
     void create_torrc() {
         fs::path torrc_path = get_torrc_path();
-        fs::path data_dir = get_data_dir();
 
         std::ofstream torrc(torrc_path);
         if (!torrc) {
@@ -90,200 +142,406 @@ private:
 
         torrc << "SocksPort " << config_.socks_port << "\n";
         torrc << "DataDirectory " << get_tor_data_dir().string() << "\n";
+        torrc << "ControlPort 127.0.0.1:" << config_.control_port << "\n";
+        torrc << "CookieAuthentication 1\n";
+        torrc << "CookieAuthFile " << (get_tor_data_dir() / "control_auth_cookie").string() << "\n";
+        // Exits with us until the control connection owns it
+        torrc << "__OwningControllerProcess " << TorProcess::current_pid() << "\n";
+
+        // Read through the pipe, the last lines end up in error messages
+        torrc << "Log notice stdout\n";
+    }
+
+    fs::path tor_executable() const {
+#ifdef _WIN32
+        fs::path bundled = exe_folder_ / "tor" / "tor.exe";
+#else
+        fs::path bundled = exe_folder_ / "tor" / "tor";
+#endif
+        if (fs::exists(bundled)) return bundled;
+#ifndef _WIN32
+        return "tor";   // from PATH, where servers have it
+#else
+        throw std::runtime_error("Tor executable not found: " + bundled.string());
+#endif
+    }
+
+    bool is_process_running() const {
+        return process_.running();
+    }
+
+    std::string tor_log_tail() const {
+        return process_.output_tail();
+    }
+
+    void check_stopping() const {
+        if (stopping_) throw std::runtime_error("Tor launch cancelled");
+    }
+
+    // "ED25519-V3:<base64>" as ADD_ONION takes it, empty when there is none
+    std::string load_onion_key() const {
+        std::ifstream in(get_onion_key_path());
+        std::string key;
+        std::getline(in, key);
+        while (!key.empty() && std::isspace(static_cast<unsigned char>(key.back()))) key.pop_back();
+        if (!key.empty()) return key;
+
+        // A HiddenServiceDir key is a 32-byte header and the same 64-byte
+        // expanded secret ADD_ONION expects
+        std::ifstream legacy(get_hidden_dir() / "hs_ed25519_secret_key", std::ios::binary);
+        std::string blob((std::istreambuf_iterator<char>(legacy)), std::istreambuf_iterator<char>());
+        if (blob.size() != 96 || blob.compare(0, 29, "== ed25519v1-secret: type0 ==") != 0) return "";
+        return "ED25519-V3:" + base64::encode(blob.data() + 32, 64);
+    }
+
+    void save_onion_key(const std::string& key) const {
+        fs::path tmp = get_onion_key_path();
+        tmp += ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::trunc);
+            if (!out) throw std::runtime_error("Cannot write onion key: " + tmp.string());
+            fs::permissions(tmp, fs::perms::owner_read | fs::perms::owner_write);
+            out << key << "\n";
+        }
+        fs::rename(tmp, get_onion_key_path());
+    }
 
-        if (config_.mode == TorMode::HIDDEN_SERVICE && config_.hidden_service_port.has_value()) {
-            torrc << "HiddenServiceDir " << get_hidden_dir().string() << "\n";
-            torrc << "HiddenServicePort 80 127.0.0.1:" << config_.hidden_service_port.value() << "\n";
+    // Ephemeral service on our control connection: it goes away with the
+    // connection, the key file brings the same address back next time
+    void add_onion_service() {
+        if (config_.mode != TorMode::HIDDEN_SERVICE || !config_.hidden_service_port) return;
+
+        std::string key = load_onion_key();
+        bool fresh = key.empty();
+        auto reply = control_.command("ADD_ONION " + (fresh ? std::string("NEW:ED25519-V3") : key) +
+                                      " Port=80,127.0.0.1:" + std::to_string(*config_.hidden_service_port));
+        if (!reply.ok()) {
+            throw std::runtime_error("ADD_ONION failed: " +
+                                     (reply.lines.empty() ? std::string("no answer") : reply.lines.front()));
         }
 
-        torrc << "Log notice file " << (data_dir / "tor.log").string() << "\n";
-        torrc << "Log notice stdout\n";  
+        std::string service_id;
+        for (const auto& line : reply.lines) {
+            if (line.rfind("ServiceID=", 0) == 0) service_id = line.substr(10);
+            if (line.rfind("PrivateKey=", 0) == 0) key = line.substr(11);
+        }
+        if (service_id.empty()) throw std::runtime_error("ADD_ONION returned no service id");
+
+        if (fresh || !fs::exists(get_onion_key_path())) save_onion_key(key);
+        onion_address_ = service_id + ".onion";
     }
 
-    bool is_process_running() const {
-        if (!process_info_.hProcess) return false;
+    // Another role's Tor on the shared control port, if there is one
+    bool attach() {
+        if (!control_.connect(config_.control_port)) return false;
+
+        std::string error;
+        if (!control_.authenticate_cookie(error)) {
+            control_.close();
+            throw std::runtime_error("Tor on control port " + std::to_string(config_.control_port) +
+                                     " refused us: " + error);
+        }
+        return true;
+    }
 
-        DWORD exit_code;
-        if (!GetExitCodeProcess(process_info_.hProcess, &exit_code)) {
-            return false;
+    // SocksPort values Tor has now, and whether ours is one of them
+    std::vector<std::string> socks_ports(bool& has_own) {
+        auto reply = control_.command("GETCONF SocksPort");
+        if (!reply.ok()) throw std::runtime_error("Tor control port: GETCONF SocksPort failed");
+
+        const std::string own = std::to_string(config_.socks_port);
+        std::vector<std::string> values;
+        has_own = false;
+        for (const auto& line : reply.lines) {
+            std::string value = line == "SocksPort" ? "9050" : line.substr(line.find('=') + 1);
+            std::string port = value.substr(0, value.find(' '));
+            port = port.substr(port.rfind(':') + 1);
+            if (port == own) {
+                has_own = true;
+            } else {
+                values.push_back(value);
+            }
         }
-        return exit_code == STILL_ACTIVE;
+        return values;
+    }
+
+    bool set_socks_ports(const std::vector<std::string>& values) {
+        std::string setconf = "SETCONF";
+        for (const auto& value : values) setconf += " SocksPort=" + TorControl::quote(value);
+        return control_.command(setconf).ok();
     }
 
-    std::string read_tor_log() const {
-        fs::path log_path = get_data_dir() / "tor.log";
-        if (!fs::exists(log_path)) return "";
+    // An attached role still gets its own SOCKS port, added next to the
+    // ones already open. Under config_lock_, or two roles would each
+    // write back the list without the other's port.
+    void ensure_socks_port() {
+        bool has_own;
+        auto values = socks_ports(has_own);
+        if (has_own) return;
+        values.push_back(std::to_string(config_.socks_port));
+        if (!set_socks_ports(values)) {
+            throw std::runtime_error("Tor refused to open SocksPort " + std::to_string(config_.socks_port));
+        }
+    }
 
-        std::ifstream log_file(log_path);
-        std::stringstream buffer;
-        buffer << log_file.rdbuf();
-        return buffer.str();
+    // Tor exits when our control connection closes, which also covers a
+    // crash, until release_tor() hands it over
+    void take_ownership() {
+        if (!control_.command("TAKEOWNERSHIP").ok() ||
+            !control_.command("RESETCONF __OwningControllerProcess").ok()) {
+            throw std::runtime_error("Tor control port: TAKEOWNERSHIP failed");
+        }
     }
 
-    void wait_for_hostname() {
-        if (config_.mode != TorMode::HIDDEN_SERVICE) {
+    // On stop, under config_lock_. The last role using Tor halts it, HALT
+    // exits at once and cleanly. Otherwise only our SocksPort closes, and a
+    // Tor we started is left running for the others.
+    void release_tor() {
+        users_.unlock();
+        if (users_.try_lock()) {
+            control_.command("SIGNAL HALT", std::chrono::seconds(1));
+            users_.unlock();
             return;
         }
 
-        fs::path hostname_path = get_hidden_dir() / "hostname";
+        try {
+            bool has_own;
+            auto values = socks_ports(has_own);
+            if (has_own && !values.empty()) set_socks_ports(values);
+        } catch (const std::exception&) {
+            // Tor keeps the port open, nothing lost
+        }
+
+        if (!attached_ && control_.command("DROPOWNERSHIP").ok()) {
+            // Nobody reads its output from now on
+            control_.command("SETCONF Log=" +
+                             TorControl::quote("notice file " + (get_tor_data_dir() / "notices.log").string()));
+            process_.detach();
+        }
+    }
+
+    // The control port opens a moment after the process starts
+    void connect_control() {
+        auto deadline = std::chrono::steady_clock::now() + CONTROL_TIMEOUT;
+        auto delay = std::chrono::milliseconds(50);
 
-      
-        for (int i = 0; i < 120; ++i) {
+        while (!control_.connect(config_.control_port)) {
+            check_stopping();
             if (!is_process_running()) {
-                std::string log_content = read_tor_log();
-                throw std::runtime_error(
-                    "Tor process died during startup.\nLast log entries:\n" +
-                    log_content.substr(log_content.length() > 1000 ? log_content.length() - 1000 : 0)
-                );
+                throw std::runtime_error("Tor process died during startup.\nLast log entries:\n" +
+                                         tor_log_tail());
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                throw std::runtime_error("Tor control port " + std::to_string(config_.control_port) +
+                                         " did not open");
+            }
+            std::this_thread::sleep_for(delay);
+            delay = std::min(delay * 2, std::chrono::milliseconds(500));
+        }
+
+        std::string error;
+        if (!control_.authenticate_cookie(error)) {
+            throw std::runtime_error("Tor control port: " + error);
+        }
+    }
+
+    // Follows STATUS_CLIENT bootstrap events until Tor reports 100%
+    void wait_for_tor_bootstrap(const TorProgressCallback& on_progress) {
+        if (!control_.command("SETEVENTS STATUS_CLIENT").ok()) {
+            throw std::runtime_error("Tor control port: SETEVENTS failed");
+        }
+
+        // Events only cover what happens from now on
+        TorBootstrap last;
+        auto report = [&](const std::string& line) {
+            auto status = parse_tor_bootstrap(line);
+            if (!status) return false;
+            last = *status;
+            if (on_progress) on_progress(last);
+            return last.progress >= 100;
+        };
+
+        auto phase = control_.command("GETINFO status/bootstrap-phase");
+        bool done = phase.ok() && !phase.lines.empty() && report(phase.lines.front());
+
+        auto deadline = std::chrono::steady_clock::now() + BOOTSTRAP_TIMEOUT;
+        while (!done) {
+            check_stopping();
+            if (!attached_ && !is_process_running()) {
+                throw std::runtime_error("Tor process died during bootstrap.\nLast log entries:\n" +
+                                         tor_log_tail());
+            }
+            if (std::chrono::steady_clock::now() >= deadline) {
+                throw std::runtime_error("Tor bootstrap stuck at " + std::to_string(last.progress) +
+                                         "%: " + last.summary);
+            }
+            if (!control_.connected()) {
+                throw std::runtime_error("Tor closed the control connection during bootstrap");
             }
 
-          
-            if (fs::exists(hostname_path)) {
-                std::ifstream hostfile(hostname_path);
-                if (hostfile && std::getline(hostfile, onion_address_)) {
-                  
-                    onion_address_.erase(
-                        std::remove_if(onion_address_.begin(), onion_address_.end(), ::isspace),
-                        onion_address_.end()
-                    );
-
-                    if (!onion_address_.empty()) {
-                        return;
-                    }
-                }
+            // The timeout only bounds how late a dead process is noticed
+            if (auto event = control_.next_event(std::chrono::milliseconds(500))) {
+                done = report(*event);
             }
+        }
+
+        control_.command("SETEVENTS");
+    }
 
-            Sleep(500); 
+    // Runs on the process reader thread
+    void on_tor_exit(int exit_code) {
+        {
+            std::lock_guard<std::mutex> lk(supervisor_mtx_);
+            if (stopping_) return;
+            crashed_ = true;
+            crash_reason_ = "Tor exited (code " + std::to_string(exit_code) + ")";
         }
+        supervisor_cv_.notify_all();
+    }
 
-        std::string log_content = read_tor_log();
-        throw std::runtime_error(
-            "Tor started, but onion hostname not found after 60 seconds.\nTor log:\n" +
-            log_content.substr(log_content.length() > 1000 ? log_content.length() - 1000 : 0)
-        );
+    void notify(const std::string& message) {
+        if (on_event_) on_event_(message);
     }
 
-    void wait_for_tor_bootstrap() {
-       
-        fs::path log_path = get_data_dir() / "tor.log";
+    // Nothing else reads the control connection after launch(), so this
+    // is where a vanished shared Tor shows up: the connection closes
+    void watch_attachment() {
+        while (!stopping_ && control_.connected()) {
+            control_.next_event(std::chrono::milliseconds(500));
+        }
+        std::lock_guard<std::mutex> lk(supervisor_mtx_);
+        if (stopping_) return;
+        crashed_ = true;
+        crash_reason_ = "Shared Tor went away";
+    }
 
-        for (int i = 0; i < 60; ++i) {  
-            if (!is_process_running()) {
-                throw std::runtime_error("Tor process died during bootstrap");
+    void supervise_loop() {
+        std::chrono::seconds delay = RESTART_MIN_DELAY;
+        std::unique_lock<std::mutex> lk(supervisor_mtx_);
+        for (;;) {
+            if (attached_) {
+                lk.unlock();
+                watch_attachment();
+                lk.lock();
             }
+            supervisor_cv_.wait(lk, [&] { return stopping_ || crashed_; });
+            if (stopping_) return;
+            crashed_ = false;
 
-            if (fs::exists(log_path)) {
-                std::ifstream log_file(log_path);
-                std::string log_content((std::istreambuf_iterator<char>(log_file)),
-                                       std::istreambuf_iterator<char>());
-
-             
-                if (log_content.find("Bootstrapped 100%") != std::string::npos ||
-                    log_content.find("100% (done): Done") != std::string::npos) {
-                    return;
-                }
-
-     
-                if (log_content.find("[err]") != std::string::npos ||
-                    log_content.find("[warn] Problem bootstrapping") != std::string::npos) {
-                    throw std::runtime_error("Tor bootstrap error. Check log: " + log_path.string());
-                }
+            if (std::chrono::steady_clock::now() - started_at_ >= STABLE_AFTER) {
+                delay = RESTART_MIN_DELAY;
             }
-
-            Sleep(500);
+            notify(crash_reason_ + ", restarting in " + std::to_string(delay.count()) + "s");
+            if (supervisor_cv_.wait_for(lk, delay, [&] { return stopping_.load(); })) return;
+            delay = std::min(delay * 2, RESTART_MAX_DELAY);
+
+            lk.unlock();
+            try {
+                launch();
+                notify("Tor restarted");
+            } catch (const std::exception& e) {
+                control_.close();
+                process_.terminate();
+                attached_ = false;
+                lk.lock();
+                if (stopping_) return;
+                crashed_ = true;
+                crash_reason_ = std::string("Tor restart failed: ") + e.what();
+                continue;
+            }
+            lk.lock();
         }
     }
 
 public:
     TorLauncher(const fs::path& exe_folder, const TorConfig& config)
-        : exe_folder_(exe_folder), config_(config) {
-        process_info_ = {};
-    }
+        : config_(config), exe_folder_(exe_folder),
+          config_lock_("config", config.control_port), users_("users", config.control_port) {}
 
     ~TorLauncher() {
         stop();
     }
 
-    std::string launch() {
-        fs::path tor_path = exe_folder_ / "tor" / "tor.exe";
-
-        if (!fs::exists(tor_path)) {
-            throw std::runtime_error("Tor executable not found: " + tor_path.string());
-        }
-
-        fs::create_directories(get_data_dir());
+    // Attaches to the Tor another role on this host runs, or starts one
+    // for everybody. Returns once Tor has bootstrapped, with the onion
+    // address for a hidden service. on_progress sees every bootstrap step.
+    std::string launch(const TorProgressCallback& on_progress = nullptr) {
+        check_stopping();
         create_directories();
-        create_torrc();
-
-        STARTUPINFOA si;
-        ZeroMemory(&si, sizeof(si));
-        si.cb = sizeof(si);
-        si.dwFlags = STARTF_USESHOWWINDOW;
-        si.wShowWindow = SW_HIDE;
-
-        std::string cmd = "\"" + tor_path.string() + "\" -f \"" + get_torrc_path().string() + "\"";
-        std::vector<char> cmd_buf(cmd.begin(), cmd.end());
-        cmd_buf.push_back('\0');
-
-        process_info_ = {};
-        if (!CreateProcessA(
-                nullptr,
-                cmd_buf.data(),
-                nullptr,
-                nullptr,
-                FALSE,
-                CREATE_NO_WINDOW,
-                nullptr,
-                nullptr,
-                &si,
-                &process_info_))
-        {
-            DWORD err = GetLastError();
-            LPSTR msgBuf = nullptr;
-            FormatMessageA(
-                FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
-                nullptr, err, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
-                (LPSTR)&msgBuf, 0, nullptr);
-
-            std::string errmsg = "Failed to launch Tor. WinErr=" + std::to_string(err);
-            if (msgBuf) {
-                errmsg += ": " + std::string(msgBuf);
-                LocalFree(msgBuf);
-            }
-            throw std::runtime_error(errmsg);
-        }
 
-       
-        Sleep(2000);
-       
-        if (!is_process_running()) {
-            throw std::runtime_error("Tor process failed to start");
+        control_.close();
+        std::unique_lock<TorHostLock> host(config_lock_);
+        attached_ = attach();
+        if (!attached_) {
+            try {
+                create_torrc();
+                process_.start(tor_executable(), {"-f", get_torrc_path().string()}, nullptr,
+                               [this](int exit_code) { on_tor_exit(exit_code); });
+                connect_control();
+                take_ownership();
+            } catch (const std::exception&) {
+                // Another role may have started it at the same moment
+                control_.close();
+                process_.terminate();
+                if (stopping_ || !attach()) throw;
+                attached_ = true;
+            }
         }
+        if (attached_) ensure_socks_port();
+        users_.lock_shared();
+        host.unlock();
 
-      
-        wait_for_tor_bootstrap();
-        
-        wait_for_hostname();
+        wait_for_tor_bootstrap(on_progress);
+        add_onion_service();
 
+        {
+            std::lock_guard<std::mutex> lk(supervisor_mtx_);
+            started_at_ = std::chrono::steady_clock::now();
+        }
         return onion_address_;
     }
 
-    void stop() {
-        if (process_info_.hProcess) {
-            TerminateProcess(process_info_.hProcess, 0);
-            WaitForSingleObject(process_info_.hProcess, 5000);
+    // After a successful launch(): whenever Tor exits by itself (or the
+    // shared one we attached to goes away) it is launched again, waiting
+    // 1 s, 2 s, 4 s ... up to a minute between attempts. The delay starts
+    // over once Tor stayed up for STABLE_AFTER. The onion address survives,
+    // its key is kept in the role's data dir.
+    void supervise(TorEventCallback on_event = nullptr) {
+        std::lock_guard<std::mutex> lk(supervisor_mtx_);
+        if (supervisor_.joinable() || stopping_) return;
+        on_event_ = std::move(on_event);
+        supervisor_ = std::thread([this] { supervise_loop(); });
+    }
 
-            CloseHandle(process_info_.hProcess);
-            process_info_.hProcess = NULL;
+    // From another thread: a launch() in progress throws within half a
+    // second, nothing is restarted. stop() still cleans up.
+    void cancel() {
+        {
+            std::lock_guard<std::mutex> lk(supervisor_mtx_);
+            stopping_ = true;
+        }
+        supervisor_cv_.notify_all();
+    }
 
-            if (process_info_.hThread) {
-                CloseHandle(process_info_.hThread);
-                process_info_.hThread = NULL;
-            }
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lk(supervisor_mtx_);
+            stopping_ = true;
+        }
+        supervisor_cv_.notify_all();
+        if (supervisor_.joinable()) supervisor_.join();
 
-            process_info_.dwProcessId = 0;
-            process_info_.dwThreadId = 0;
+        // Our onion goes first, other roles may keep Tor running
+        if (control_.connected() && !onion_address_.empty()) {
+            control_.command("DEL_ONION " + onion_address_.substr(0, onion_address_.find('.')));
+        }
+        if (control_.connected() && users_.held()) {
+            std::lock_guard<TorHostLock> host(config_lock_);
+            release_tor();
         }
+        control_.close();
+        process_.terminate();       // a Tor that did not halt, unless handed over
+        users_.unlock();
     }
 
     const std::string& get_onion_address() const {
@@ -294,8 +552,13 @@ public:
         return config_;
     }
 
-    PROCESS_INFORMATION get_process_info() const {
-        return process_info_;
+    // The Tor process this role started, false while attached to another's
+    bool is_running() const {
+        return is_process_running();
+    }
+
+    bool is_attached() const {
+        return attached_;
     }
 
     bool is_hidden_service() const {
@@ -0,0 +1,365 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#ifndef TOR_PROCESS_HPP
+#define TOR_PROCESS_HPP
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+// One child process with its stdout and stderr read through a pipe.
+// CreateProcess on Windows, fork/exec on POSIX. A reader thread hands
+// every output line to on_line, keeps the last lines for error messages
+// and, at end of output, reaps the child and calls on_exit.
+//
+// The child is not tied to our lifetime: it outlives the thread that
+// started it, and detach() leaves it running after we exit. Tor itself
+// exits with its owning controller, see TorLauncher.
+class TorProcess {
+public:
+    static constexpr size_t TAIL_LINES = 40;
+    static constexpr int READ_POLL_MS = 200;     // how soon the reader notices detach()
+
+    using LineCallback = std::function<void(const std::string&)>;
+    using ExitCallback = std::function<void(int exit_code)>;
+
+    TorProcess() = default;
+    ~TorProcess() { terminate(); }
+
+    TorProcess(const TorProcess&) = delete;
+    TorProcess& operator=(const TorProcess&) = delete;
+
+    // Throws std::runtime_error when the process cannot be created
+    void start(const std::filesystem::path& exe, const std::vector<std::string>& args,
+               LineCallback on_line = nullptr, ExitCallback on_exit = nullptr) {
+        terminate();
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            tail_.clear();
+            exited_ = false;
+            exit_code_ = -1;
+        }
+        on_line_ = std::move(on_line);
+        on_exit_ = std::move(on_exit);
+        spawn(exe, args);
+        reader_ = std::thread([this] { read_output(); });
+    }
+
+    bool running() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        return reader_.joinable() && !exited_;
+    }
+
+    std::optional<int> exit_code() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!exited_) return std::nullopt;
+        return exit_code_;
+    }
+
+    // Last lines the process printed, oldest first
+    std::string output_tail() const {
+        std::lock_guard<std::mutex> lk(mtx_);
+        std::string out;
+        for (const auto& line : tail_) out += line + "\n";
+        return out;
+    }
+
+    // Asks the process to exit, kills it after `grace`, waits until it is
+    // reaped. on_exit still runs for it.
+    void terminate(std::chrono::milliseconds grace = std::chrono::seconds(3)) {
+        if (!reader_.joinable()) return;
+        if (reader_.get_id() == std::this_thread::get_id()) return;     // from on_exit
+
+        std::unique_lock<std::mutex> lk(mtx_);
+        if (!exited_) {
+            request_exit();
+            if (!exited_cv_.wait_for(lk, grace, [&] { return exited_; })) {
+                force_exit();
+                exited_cv_.wait(lk, [&] { return exited_; });
+            }
+        }
+        lk.unlock();
+        reader_.join();
+        release();
+    }
+
+    static long current_pid() {
+#ifdef _WIN32
+        return static_cast<long>(GetCurrentProcessId());
+#else
+        return static_cast<long>(::getpid());
+#endif
+    }
+
+    // Lets the process run on by itself: its output is no longer read, it
+    // is neither stopped nor waited for, and on_exit does not run
+    void detach() {
+        if (!reader_.joinable()) return;
+        if (reader_.get_id() == std::this_thread::get_id()) return;
+        detaching_ = true;
+        reader_.join();
+        detaching_ = false;
+        release();
+    }
+
+private:
+#ifdef _WIN32
+    void spawn(const std::filesystem::path& exe, const std::vector<std::string>& args) {
+        SECURITY_ATTRIBUTES sa{sizeof(sa), nullptr, TRUE};
+        HANDLE read_end = nullptr;
+        HANDLE write_end = nullptr;
+        if (!CreatePipe(&read_end, &write_end, &sa, 0)) {
+            throw std::runtime_error("Failed to create pipe. WinErr=" + std::to_string(GetLastError()));
+        }
+        SetHandleInformation(read_end, HANDLE_FLAG_INHERIT, 0);
+
+        STARTUPINFOA si;
+        ZeroMemory(&si, sizeof(si));
+        si.cb = sizeof(si);
+        si.dwFlags = STARTF_USESHOWWINDOW | STARTF_USESTDHANDLES;
+        si.wShowWindow = SW_HIDE;
+        si.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+        si.hStdOutput = write_end;
+        si.hStdError = write_end;
+
+        std::string cmd = "\"" + exe.string() + "\"";
+        for (const auto& arg : args) cmd += " \"" + arg + "\"";
+        std::vector<char> cmd_buf(cmd.begin(), cmd.end());
+        cmd_buf.push_back('\0');
+
+        PROCESS_INFORMATION pi{};
+        BOOL created = CreateProcessA(nullptr, cmd_buf.data(), nullptr, nullptr, TRUE,
+                                      CREATE_NO_WINDOW, nullptr, nullptr, &si, &pi);
+        DWORD err = GetLastError();
+        CloseHandle(write_end);
+        if (!created) {
+            CloseHandle(read_end);
+            std::string errmsg = "Failed to launch " + exe.filename().string() +
+                                 ". WinErr=" + std::to_string(err);
+            LPSTR msg_buf = nullptr;
+            FormatMessageA(
+                FORMAT_MESSAGE_ALLOCATE_BUFFER | FORMAT_MESSAGE_FROM_SYSTEM | FORMAT_MESSAGE_IGNORE_INSERTS,
+                nullptr, err, MAKELANGID(LANG_NEUTRAL, SUBLANG_DEFAULT),
+                (LPSTR)&msg_buf, 0, nullptr);
+            if (msg_buf) {
+                errmsg += ": " + std::string(msg_buf);
+                LocalFree(msg_buf);
+            }
+            throw std::runtime_error(errmsg);
+        }
+        CloseHandle(pi.hThread);
+        process_ = pi.hProcess;
+        pipe_ = read_end;
+    }
+
+    // Bytes read, 0 at end of output, -1 once detach() asked to stop
+    long read_chunk(char* buf, size_t size) {
+        DWORD avail = 0;
+        while (PeekNamedPipe(pipe_, nullptr, 0, nullptr, &avail, nullptr) && avail == 0) {
+            if (detaching_) return -1;
+            Sleep(READ_POLL_MS);
+        }
+        DWORD n = 0;
+        if (!ReadFile(pipe_, buf, static_cast<DWORD>(size), &n, nullptr)) return 0;
+        return static_cast<long>(n);
+    }
+
+    void wait_exit() { WaitForSingleObject(process_, INFINITE); }
+
+    int collect() {
+        DWORD code = 0;
+        GetExitCodeProcess(process_, &code);
+        return static_cast<int>(code);
+    }
+
+    // No polite signal for a console-less child, the control port is the
+    // graceful way out
+    void request_exit() { force_exit(); }
+    void force_exit() { TerminateProcess(process_, 1); }
+
+    void release() {
+        if (pipe_) CloseHandle(pipe_);
+        if (process_) CloseHandle(process_);
+        pipe_ = nullptr;
+        process_ = nullptr;
+    }
+
+    HANDLE process_ = nullptr;
+    HANDLE pipe_ = nullptr;
+#else
+    void spawn(const std::filesystem::path& exe, const std::vector<std::string>& args) {
+        int fds[2];
+        if (::pipe(fds) != 0) {
+            throw std::runtime_error(std::string("Failed to create pipe: ") + std::strerror(errno));
+        }
+        ::fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+
+        // Built before fork, the child only calls async-signal-safe functions
+        std::string path = exe.string();
+        std::vector<char*> argv;
+        argv.push_back(path.data());
+        std::vector<std::string> owned(args);
+        for (auto& arg : owned) argv.push_back(arg.data());
+        argv.push_back(nullptr);
+        bool search_path = exe.filename() == exe;
+
+        pid_t pid = ::fork();
+        if (pid < 0) {
+            ::close(fds[0]);
+            ::close(fds[1]);
+            throw std::runtime_error(std::string("fork failed: ") + std::strerror(errno));
+        }
+        if (pid == 0) {
+            ::dup2(fds[1], STDOUT_FILENO);
+            ::dup2(fds[1], STDERR_FILENO);
+            ::close(fds[0]);
+            ::close(fds[1]);
+            if (search_path) {
+                ::execvp(argv[0], argv.data());
+            } else {
+                ::execv(argv[0], argv.data());
+            }
+            const char msg[] = "exec failed: ";
+            (void)!::write(STDERR_FILENO, msg, sizeof(msg) - 1);
+            (void)!::write(STDERR_FILENO, argv[0], std::strlen(argv[0]));
+            (void)!::write(STDERR_FILENO, "\n", 1);
+            _exit(127);
+        }
+
+        ::close(fds[1]);
+        pid_ = pid;
+        pipe_ = fds[0];
+    }
+
+    long read_chunk(char* buf, size_t size) {
+        for (;;) {
+            pollfd pfd{pipe_, POLLIN, 0};
+            int ready = ::poll(&pfd, 1, READ_POLL_MS);
+            if (detaching_) return -1;
+            if (ready == 0 || (ready < 0 && errno == EINTR)) continue;
+
+            ssize_t n = ::read(pipe_, buf, size);
+            if (n >= 0) return static_cast<long>(n);
+            if (errno != EINTR) return 0;
+        }
+    }
+
+    // Leaves the child unreaped, so a kill() under mtx_ can never hit a
+    // recycled pid
+    void wait_exit() {
+        siginfo_t info{};
+        while (::waitid(P_PID, static_cast<id_t>(pid_), &info, WEXITED | WNOWAIT) < 0 && errno == EINTR) {}
+    }
+
+    int collect() {
+        int status = 0;
+        while (::waitpid(pid_, &status, 0) < 0) {
+            if (errno != EINTR) return -1;
+        }
+        if (WIFEXITED(status)) return WEXITSTATUS(status);
+        return 128 + WTERMSIG(status);
+    }
+
+    void request_exit() { ::kill(pid_, SIGTERM); }
+    void force_exit() { ::kill(pid_, SIGKILL); }
+
+    void release() {
+        if (pipe_ >= 0) ::close(pipe_);
+        pipe_ = -1;
+        pid_ = -1;
+    }
+
+    pid_t pid_ = -1;
+    int pipe_ = -1;
+#endif
+
+    void read_output() {
+        std::string pending;
+        char buf[4096];
+        long n;
+        while ((n = read_chunk(buf, sizeof(buf))) > 0) {
+            pending.append(buf, static_cast<size_t>(n));
+            size_t eol;
+            while ((eol = pending.find('\n')) != std::string::npos) {
+                std::string line = pending.substr(0, eol);
+                pending.erase(0, eol + 1);
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                add_line(line);
+            }
+        }
+        if (!pending.empty()) add_line(pending);
+        if (n < 0) return;      // detached
+
+        // End of output: the process is gone or about to be
+        wait_exit();
+        int code;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            code = collect();
+            exited_ = true;
+            exit_code_ = code;
+        }
+        exited_cv_.notify_all();
+        if (on_exit_) on_exit_(code);
+    }
+
+    void add_line(const std::string& line) {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            tail_.push_back(line);
+            if (tail_.size() > TAIL_LINES) tail_.pop_front();
+        }
+        if (on_line_) on_line_(line);
+    }
+
+    mutable std::mutex mtx_;
+    std::condition_variable exited_cv_;
+    bool exited_ = false;
+    int exit_code_ = -1;
+    std::deque<std::string> tail_;
+
+    LineCallback on_line_;
+    ExitCallback on_exit_;
+    std::thread reader_;
+    std::atomic<bool> detaching_{false};
+};
+
+#endif
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <ftxui/component/event.hpp>
+#include <ftxui/component/screen_interactive.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+// Turns "something on screen changed" into at most max_fps frames a second.
+// State changes call mark_dirty() from any thread; every mark made before the
+// next frame slot is drawn by that one frame, and while nothing is marked no
+// frame is posted at all. Input events are still drawn by ftxui right away.
+class RedrawScheduler {
+public:
+    static constexpr int DEFAULT_MAX_FPS = 20;
+
+    explicit RedrawScheduler(int max_fps = DEFAULT_MAX_FPS)
+        : interval_(std::chrono::microseconds(1000000 / std::max(1, max_fps))) {}
+
+    ~RedrawScheduler() { stop(); }
+
+    RedrawScheduler(const RedrawScheduler&) = delete;
+    RedrawScheduler& operator=(const RedrawScheduler&) = delete;
+
+    // Marks made before the screen exists are drawn with the first frame
+    void start(ftxui::ScreenInteractive* screen) {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (worker_.joinable()) return;
+        screen_ = screen;
+        stopping_ = false;
+        worker_ = std::thread([this] { run(); });
+    }
+
+    // Call once the loop has exited, before the screen goes away
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            stopping_ = true;
+        }
+        cv_.notify_all();
+        if (worker_.joinable()) worker_.join();
+    }
+
+    void mark_dirty() {
+        if (dirty_.exchange(true)) return;      // a frame is already due
+        std::lock_guard<std::mutex> lk(mtx_);
+        cv_.notify_one();
+    }
+
+    // While set, every frame slot is drawn (for animations)
+    void set_animating(bool animating) {
+        if (animating_.exchange(animating) == animating) return;
+        std::lock_guard<std::mutex> lk(mtx_);
+        cv_.notify_one();
+    }
+
+private:
+    void run() {
+        auto last_frame = std::chrono::steady_clock::now() - interval_;
+        std::unique_lock<std::mutex> lk(mtx_);
+        while (!stopping_) {
+            cv_.wait(lk, [&] { return stopping_ || dirty_.load() || animating_.load(); });
+
+            // Marks arriving until the frame slot opens join this frame
+            if (cv_.wait_until(lk, last_frame + interval_, [&] { return stopping_; })) break;
+
+            dirty_ = false;
+            last_frame = std::chrono::steady_clock::now();
+            lk.unlock();
+            screen_->PostEvent(ftxui::Event::Custom);
+            lk.lock();
+        }
+    }
+
+    const std::chrono::microseconds interval_;
+    ftxui::ScreenInteractive* screen_ = nullptr;
+
+    std::mutex mtx_;
+    std::condition_variable cv_;
+    std::atomic<bool> dirty_{false};
+    std::atomic<bool> animating_{false};
+    bool stopping_ = false;
+    std::thread worker_;
+};
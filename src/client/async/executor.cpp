@@ -0,0 +1,271 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/async/executor.hpp"
+#include "client/config.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+bool CancellationToken::cancelled() const {
+    return state_ && state_->cancelled.load();
+}
+
+uint64_t CancellationToken::subscribe(std::function<void()> fn) const {
+    if (!state_) return 0;
+    std::lock_guard<std::mutex> lk(state_->mtx);
+    if (state_->cancelled) return 0;
+    uint64_t id = state_->next_id++;
+    state_->callbacks.emplace(id, std::move(fn));
+    return id;
+}
+
+void CancellationToken::unsubscribe(uint64_t id) const {
+    if (!state_ || id == 0) return;
+    std::lock_guard<std::mutex> lk(state_->mtx);
+    state_->callbacks.erase(id);
+}
+
+CancellationSource::CancellationSource() {
+    token_.state_ = std::make_shared<CancellationToken::State>();
+}
+
+CancellationSource::CancellationSource(const CancellationToken& parent)
+    : CancellationSource() {
+    parent_ = parent;
+    auto state = token_.state_;
+    parent_sub_ = parent_.subscribe([state] { cancel_state(state); });
+    if (parent_sub_ == 0 && parent_.cancelled()) cancel();
+}
+
+CancellationSource::~CancellationSource() {
+    parent_.unsubscribe(parent_sub_);
+}
+
+void CancellationSource::cancel() {
+    cancel_state(token_.state_);
+}
+
+void CancellationSource::cancel_state(const std::shared_ptr<CancellationToken::State>& state) {
+    std::map<uint64_t, std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lk(state->mtx);
+        if (state->cancelled) return;
+        state->cancelled = true;
+        callbacks.swap(state->callbacks);
+    }
+    // Outside the lock, callbacks may subscribe or cancel elsewhere
+    for (auto& [id, fn] : callbacks) fn();
+}
+
+namespace detail {
+
+bool Waiter::fire(Reason why) {
+    if (fired.exchange(true)) return false;
+    reason = why;
+    if (why != CANCELLED) token.unsubscribe(token_sub);
+    Executor::instance().post([h = handle] { h.resume(); });
+    return true;
+}
+
+bool Waiter::watch(const std::shared_ptr<Waiter>& self, const CancellationToken& t) {
+    if (!t.can_cancel()) return true;
+    token = t;
+    uint64_t id = token.subscribe([self] { self->fire(CANCELLED); });
+    if (id == 0) return false;
+    token_sub = id;     // the callback never reads it, other sources are armed after
+    return true;
+}
+
+// Owner of a spawned task, destroys itself when the task is done
+struct Detached {
+    struct promise_type {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+}
+
+Executor& Executor::instance() {
+    static Executor executor;
+    return executor;
+}
+
+Executor::Executor() {
+    size_t n = std::max<size_t>(1, Config::ASYNC_WORKERS);
+    for (size_t i = 0; i < n; ++i) {
+        workers_.emplace_back(&Executor::worker_loop, this);
+    }
+    timer_thread_ = std::thread(&Executor::timer_loop, this);
+}
+
+Executor::~Executor() {
+    shutdown();
+}
+
+void Executor::spawn(Task<> task) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (stopping_) return;
+        outstanding_++;
+    }
+    run_root(*this, std::move(task));
+}
+
+detail::Detached Executor::run_root(Executor& executor, Task<> task) {
+    co_await executor.schedule();
+    try {
+        co_await std::move(task);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Background task failed: " << e.what() << "\n";
+    } catch (...) {
+        std::cerr << "[ERROR] Background task failed\n";
+    }
+    executor.task_finished();
+}
+
+void Executor::task_finished() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    outstanding_--;
+    idle_cv_.notify_all();
+}
+
+void Executor::post(std::function<void()> fn) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        jobs_.push_back(std::move(fn));
+    }
+    work_cv_.notify_one();
+}
+
+void Executor::add_timer(std::chrono::steady_clock::time_point deadline,
+                         std::shared_ptr<detail::Waiter> waiter) {
+    {
+        std::lock_guard<std::mutex> lk(timer_mtx_);
+        timers_.push({deadline, std::move(waiter)});
+    }
+    timer_cv_.notify_one();
+}
+
+void Executor::worker_loop() {
+    for (;;) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lk(mtx_);
+            work_cv_.wait(lk, [&] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) return;
+            job = std::move(jobs_.front());
+            jobs_.pop_front();
+        }
+        job();
+    }
+}
+
+void Executor::timer_loop() {
+    std::unique_lock<std::mutex> lk(timer_mtx_);
+    while (!timers_stopping_) {
+        if (timers_.empty()) {
+            timer_cv_.wait(lk);
+            continue;
+        }
+        auto deadline = timers_.top().deadline;
+        if (std::chrono::steady_clock::now() < deadline) {
+            timer_cv_.wait_until(lk, deadline);
+            continue;
+        }
+        auto waiter = timers_.top().waiter;
+        timers_.pop();
+        lk.unlock();
+        waiter->fire(detail::Waiter::TIMED_OUT);
+        lk.lock();
+    }
+}
+
+void Executor::shutdown() {
+    root_.cancel();
+    {
+        std::unique_lock<std::mutex> lk(mtx_);
+        if (stopping_) return;
+        // Tasks watching token() end promptly, one waiting on something
+        // else must not keep the client from exiting
+        if (!idle_cv_.wait_for(lk, SHUTDOWN_GRACE, [&] { return outstanding_ == 0; })) {
+            std::cerr << "[WARN] " << outstanding_ << " background task(s) did not stop, leaving them\n";
+            jobs_.clear();
+        }
+        stopping_ = true;
+    }
+    work_cv_.notify_all();
+    {
+        std::lock_guard<std::mutex> lk(timer_mtx_);
+        timers_stopping_ = true;
+    }
+    timer_cv_.notify_all();
+
+    for (auto& t : workers_) {
+        if (t.joinable()) t.join();
+    }
+    if (timer_thread_.joinable()) timer_thread_.join();
+}
+
+void AsyncEvent::set() {
+    std::vector<std::shared_ptr<detail::Waiter>> woken;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        set_ = true;
+        woken.swap(waiters_);
+    }
+    for (auto& w : woken) w->fire(detail::Waiter::SIGNALED);
+}
+
+void AsyncEvent::reset() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    set_ = false;
+}
+
+bool AsyncEvent::is_set() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return set_;
+}
+
+void AsyncEvent::Awaiter::await_suspend(std::coroutine_handle<> h) {
+    // Same as the timer: after arming, only locals are safe to touch
+    AsyncEvent* ev = event;
+    auto when = deadline;
+    auto w = std::make_shared<detail::Waiter>();
+    w->handle = h;
+    waiter = w;
+
+    if (!w->watch(w, token)) {
+        w->fire(detail::Waiter::CANCELLED);
+        return;
+    }
+    if (when) Executor::instance().add_timer(*when, w);
+
+    std::lock_guard<std::mutex> lk(ev->mtx_);
+    if (ev->set_) {
+        w->fire(detail::Waiter::SIGNALED);
+        return;
+    }
+    // Waiters that timed out or were cancelled are dropped on the way
+    ev->waiters_.erase(std::remove_if(ev->waiters_.begin(), ev->waiters_.end(),
+        [](const std::shared_ptr<detail::Waiter>& x) { return x->fired.load(); }), ev->waiters_.end());
+    ev->waiters_.push_back(std::move(w));
+}
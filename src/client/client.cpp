@@ -15,11 +15,13 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
+#endif
 
 #include <curl/curl.h>
 #include <ftxui/screen/screen.hpp>
@@ -29,42 +31,132 @@
 #include <iostream>
 #include <fstream>
 #include <string>
-#include <thread>
 #include <chrono>
 #include <filesystem>
 #include <vector>
 #include <atomic>
+#include <functional>
+#include <thread>
+#include <type_traits>
 
 #include "client/config.hpp"
+#include "client/async/executor.hpp"
 #include "utils/logging/logging.hpp"
 #include "client/pionniers/pionniers.hpp"
 #include "client/network/network.hpp"
+#include "client/network/curl_pool.hpp"
+#include "client/network/curl_reactor.hpp"
+#include "client/network/outbox.hpp"
+#include "client/feed/feed_cache.hpp"
 #include "client/ui/ui.hpp"
+#include "client/ui/feed_view.hpp"
+#include "client/ui/card_cache.hpp"
 #include "client/utils/gate_parser.hpp"
 #include "utils/base64.hpp"
 #include "utils/tor/tor_launcher.hpp"
+#include "utils/ui/redraw_scheduler.hpp"
 
+#ifdef _WIN32
 #pragma comment(lib, "ws2_32.lib")
+#endif
 
 namespace fs = std::filesystem;
 using namespace ftxui;
 
 // Global state definitions
 std::vector<std::string> gates;
-std::vector<std::string> posts_cache;
-std::vector<std::string> pioneers;
-std::string pioneers_source = "default";
+std::vector<FeedPost> posts_cache;
+std::mutex posts_mutex;
+PioneerDirectory pioneers;
 std::atomic<bool> tor_ready{false};
 std::atomic<int> loading_progress{0};
 std::atomic<Page> current_page{PAGE_GATE_INPUT};
 
+// Runs `work` in the background and hands its result to `done` on the UI
+// thread, so UI state is only touched there
+template <class T>
+Task<> report_to_ui(ScreenInteractive* screen, RedrawScheduler* redraw, Task<T> work,
+                    std::type_identity_t<std::function<void(T)>> done) {
+    T result = co_await std::move(work);
+    screen->Post([done = std::move(done), result] { done(result); });
+    redraw->mark_dirty();
+}
+
+// Runs on its own thread, the bootstrap can take minutes. Its progress
+// drives the loading bar.
+void launch_tor(TorLauncher* launcher, AsyncEvent* tor_up, RedrawScheduler* redraw) {
+    try {
+        launcher->launch([redraw](const TorBootstrap& status) {
+            loading_progress = status.progress;
+            redraw->mark_dirty();
+        });
+        tor_ready = true;
+        tor_up->set();
+        // Also covers a gate or pionnier on this host whose Tor we share
+        launcher->supervise([](const std::string& message) {
+            std::cerr << "[WARN] " << message << "\n";
+        });
+        // Delivers posts left over from the last run, then new ones
+        Outbox::instance().start();
+        std::cout << "SOCKS5 proxy ready on port 9050\n";
+    } catch (const std::exception& e) {
+        std::cerr << "Tor launch failed: " << e.what() << std::endl;
+        tor_ready = false;
+    }
+}
+
+Task<> refresh_pioneers(RedrawScheduler* redraw) {
+    std::cerr << "[INFO] Updating pioneers list from gates...\n";
+    if (co_await update_pioneers_from_gates()) {
+        std::cerr << "[SUCCESS] Pioneers updated successfully\n";
+    } else {
+        std::cerr << "[INFO] Using existing pioneers list\n";
+    }
+    redraw->mark_dirty();
+    co_return;
+}
+
+// Leaves the success message up for a moment, then the loading page
+Task<> show_loading_page(RedrawScheduler* redraw, AsyncEvent* gates_chosen) {
+    Executor& executor = Executor::instance();
+    if (!co_await executor.sleep_for(std::chrono::milliseconds(800), executor.token())) co_return;
+    current_page = PAGE_LOADING;
+    gates_chosen->set();
+    redraw->mark_dirty();
+}
+
+// The loading page stays at least 2 s and until Tor is up, then the feed
+// opens while the pioneer list is refreshed behind it
+Task<> open_main_page(RedrawScheduler* redraw, AsyncEvent* gates_chosen, AsyncEvent* tor_up) {
+    Executor& executor = Executor::instance();
+    CancellationToken stop = executor.token();
+
+    if (!co_await gates_chosen->wait(stop)) co_return;
+    // The loading animation is the only thing drawn without a state change
+    redraw->set_animating(true);
+    bool up = co_await executor.sleep_for(std::chrono::seconds(2), stop) &&
+              co_await tor_up->wait(stop);
+    redraw->set_animating(false);
+    if (!up) co_return;
+
+    executor.spawn(refresh_pioneers(redraw));
+    current_page = PAGE_MAIN;
+    redraw->mark_dirty();
+}
+
 int main(int argc, char* argv[]) {
     try {
         if (!fs::exists(Config::DATA_DIR)) {
             fs::create_directory(Config::DATA_DIR);
         }
 
-        gates = GatesParser::loadFromFile(Config::GATES_FILE);
+        // Last known feed, shown until the network answers
+        size_t cached_posts = load_feed_cache();
+        if (cached_posts > 0) {
+            std::cerr << "[INFO] Loaded " << cached_posts << " post(s) from the feed cache\n";
+        }
+
+        gates = load_gates_file();
         
         if (gates.empty()) {
             current_page = PAGE_GATE_INPUT;
@@ -80,41 +172,34 @@ int main(int argc, char* argv[]) {
         // Load pioneers from file
         auto file_p = load_pioneers_file();
         if (!file_p.empty()) {
-            std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-            for (auto &p : file_p) {
-                if (std::find(pioneers.begin(), pioneers.end(), p) == pioneers.end())
-                    pioneers.push_back(p);
-            }
-            pioneers_source = "file";
+            pioneers.reset(file_p, "file");
         }
 
-        if (pioneers.empty()) {
-            std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-            pioneers.push_back(Config::DEFAULT_PIONEER);
-            pioneers_source = "default";
+        if (pioneers.size() == 0) {
+            pioneers.reset({Config::DEFAULT_PIONEER}, "default");
             save_pioneers_file();
         }
 
         // Launch Tor
         fs::path exe_folder = fs::current_path();
         auto screen = ScreenInteractive::Fullscreen();
+        RedrawScheduler redraw;
         std::cout << "Waiting for SOCKS5..." << std::endl;
 
         TorConfig config("client", 9050);
         TorLauncher tor_launcher(exe_folder, config);
 
-        std::thread tor_thread([&]() {
-            try {
-                tor_launcher.launch();
-                tor_ready = true;
-                std::cout << "SOCKS5 proxy ready on port 9050\n";
-            } catch (const std::exception& e) {
-                std::cerr << "Tor launch failed: " << e.what() << std::endl;
-                tor_ready = false;
-            }
-        });
+        Executor& executor = Executor::instance();
+        AsyncEvent tor_up;
+        AsyncEvent gates_chosen;        // gate page done, loading page up
+        if (current_page == PAGE_LOADING) gates_chosen.set();
 
-        std::this_thread::sleep_for(std::chrono::seconds(10));
+        // Stopping the thread (or leaving the scope) cancels the bootstrap
+        std::jthread tor_thread([&](std::stop_token stop) {
+            std::stop_callback cancel(stop, [&] { tor_launcher.cancel(); });
+            launch_tor(&tor_launcher, &tor_up, &redraw);
+        });
+        executor.spawn(open_main_page(&redraw, &gates_chosen, &tor_up));
 
         std::string base64_input;
         std::string gate_error_message;
@@ -141,15 +226,15 @@ int main(int argc, char* argv[]) {
                         return;
                     }
          
-                    GatesParser::saveToFile(parsed_gates, Config::GATES_FILE);
+                    if (!save_gates_file(parsed_gates)) {
+                        gate_error_message = "Error: cannot save gates";
+                        return;
+                    }
                     
                     gates = parsed_gates;
                     
                     gate_success_message = "Loaded " + std::to_string(gates.size()) + " gate(s)";
-                    
-                    std::this_thread::sleep_for(std::chrono::milliseconds(800));
-                    current_page = PAGE_LOADING;
-                    screen.PostEvent(Event::Custom);
+                    executor.spawn(show_loading_page(&redraw, &gates_chosen));
                     
                 } catch (const std::exception& e) {
                     gate_error_message = std::string("Error: ") + e.what();
@@ -160,12 +245,11 @@ int main(int argc, char* argv[]) {
                 gates.clear();
                 gates.push_back(Config::DEFAULT_GATE);
                 
-                try {
-                    GatesParser::saveToFile(gates, Config::GATES_FILE);
-                } catch (...) {}
+                save_gates_file(gates);
                 
                 current_page = PAGE_LOADING;
-                screen.PostEvent(Event::Custom);
+                gates_chosen.set();
+                redraw.mark_dirty();
             }
         );
 
@@ -183,49 +267,48 @@ int main(int argc, char* argv[]) {
             "🚪 Exit"
         };
 
+        // Lets posts show up while the feed is still downloading
+        auto feed_changed = [&] { redraw.mark_dirty(); };
+
+        // Cards are built once per post and width, callers hold posts_mutex
+        FeedView feed_view;
+        PostCardCache card_cache;
+        auto card_element = [&](size_t i) {
+            return card_cache.get(posts_cache[i], i, feed_view.width()).element;
+        };
+        auto card_height = [&](size_t i) {
+            return card_cache.get(posts_cache[i], i, feed_view.width()).height;
+        };
+
         MenuOption menu_option;
         menu_option.on_enter = [&] {
             if (selected == 0) {
                 loading = true;
-                screen.PostEvent(Event::Custom);
-                std::thread([&]() {
-                    if (fetch_posts()) {
-                        status_msg = "✓ Posts loaded successfully";
-                    } else {
-                        status_msg = "✗ Failed to load posts";
-                    }
+                executor.spawn(report_to_ui<bool>(&screen, &redraw, fetch_posts_async(feed_changed), [&](bool ok) {
+                    status_msg = ok ? "✓ Posts loaded successfully" : "✗ Failed to load posts";
                     loading = false;
-                    screen.PostEvent(Event::Custom);
-                }).detach();
+                }));
             } else if (selected == 1) {
                 current_page = PAGE_NEW_POST;
                 input_text.clear();
             } else if (selected == 2) {
                 loading = true;
-                screen.PostEvent(Event::Custom);
-                std::thread([&]() {
-                    if (fetch_posts()) {
-                        status_msg = "✓ Feed refreshed";
-                    } else {
-                        status_msg = "✗ Refresh failed";
-                    }
+                executor.spawn(report_to_ui<bool>(&screen, &redraw, fetch_posts_async(feed_changed), [&](bool ok) {
+                    status_msg = ok ? "✓ Feed refreshed" : "✗ Refresh failed";
                     loading = false;
-                    screen.PostEvent(Event::Custom);
-                }).detach();
+                }));
             } else if (selected == 3) {
                 current_page = PAGE_PIONEERS;
                 {
-                    std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
+                    auto directory = pioneers.snapshot();
                     std::string json = "[";
-                    for (size_t i = 0; i < pioneers.size(); ++i) {
+                    for (size_t i = 0; i < directory->size(); ++i) {
                         if (i) json += ",";
-                        json += "\"" + pioneers[i] + "\"";
+                        json += "\"" + directory->list[i].address.to_string() + "\"";
                     }
                     json += "]";
-                    std::vector<unsigned char> v(json.begin(), json.end());
-                    pioneers_export_b64 = base64::encode(v);
+                    pioneers_export_b64 = base64::encode(json);
                 }
-                screen.PostEvent(Event::Custom);
             } else if (selected == 4) {
                 screen.ExitLoopClosure()();
             }
@@ -252,18 +335,16 @@ int main(int argc, char* argv[]) {
             // PIONEERS PAGE
             if (current_page == PAGE_PIONEERS) {
                 Elements list;
-                {
-                    std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-                    if (pioneers.empty()) {
-                        list.push_back(text("No pioneers available") | color(Color::Yellow) | center);
-                    } else {
-                        int idx = 1;
-                        for (const auto &p : pioneers) {
-                            list.push_back(hbox({
-                                text(std::to_string(idx++) + ". ") | color(Color::Red),
-                                text(p) | color(Color::GreenLight)
-                            }));
-                        }
+                auto directory = pioneers.snapshot();
+                if (directory->empty()) {
+                    list.push_back(text("No pioneers available") | color(Color::Yellow) | center);
+                } else {
+                    int idx = 1;
+                    for (const auto &p : directory->list) {
+                        list.push_back(hbox({
+                            text(std::to_string(idx++) + ". ") | color(Color::Red),
+                            text(p.address.to_string()) | color(Color::GreenLight)
+                        }));
                     }
                 }
                 return vbox({
@@ -276,7 +357,7 @@ int main(int argc, char* argv[]) {
                         separator(),
                         vbox({
                             text("Source:") | color(Color::Red) | bold,
-                            text(pioneers_source) | color(Color::GreenLight),
+                            text(directory->source) | color(Color::GreenLight),
                             text(""),
                             text("Export (base64):") | color(Color::Red) | bold,
                             text(pioneers_export_b64.empty() ? "(none)" : pioneers_export_b64) | color(Color::Yellow) | border,
@@ -323,11 +404,18 @@ int main(int argc, char* argv[]) {
                     text("⌛") | color(Color::Red) | bold,
                     text(" Processing...") | color(Color::Yellow)
                 }) | center);
-            } else if (posts_cache.empty()) {
-                posts_ui.push_back(text("No posts yet. Be the first to post!") | color(Color::GreenLight) | center);
-            } else {
-                for (size_t i = 0; i < posts_cache.size(); ++i) {
-                    posts_ui.push_back(post_card(posts_cache[i], i));
+            }
+            std::string feed_position;
+            {
+                // Only the cards in view are built, whatever the feed size
+                std::lock_guard<std::mutex> lk(posts_mutex);
+                if (posts_cache.empty()) {
+                    if (!loading) {
+                        posts_ui.push_back(text("No posts yet. Be the first to post!") | color(Color::GreenLight) | center);
+                    }
+                } else {
+                    posts_ui.push_back(feed_view.render(posts_cache.size(), card_element, card_height) | flex);
+                    feed_position = feed_view.position(posts_cache.size());
                 }
             }
 
@@ -341,8 +429,12 @@ int main(int argc, char* argv[]) {
                     }),
                     separator(),
                     vbox({
-                        text("╔═ FEED ═╗") | color(Color::Yellow) | bold,
-                        vbox(posts_ui) | vscroll_indicator | frame | size(HEIGHT, GREATER_THAN, 12) | flex
+                        hbox({
+                            text("╔═ FEED ═╗") | color(Color::Yellow) | bold,
+                            filler(),
+                            text(feed_position) | color(Color::GreenLight) | dim
+                        }),
+                        vbox(posts_ui) | size(HEIGHT, GREATER_THAN, 12) | flex
                     }) | flex
                 }),
                 separator(),
@@ -376,33 +468,40 @@ int main(int argc, char* argv[]) {
                     return true;
                 }
                 if (event == Event::Character('d') || event == Event::Character('D')) {
-                    {
-                        std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-                        pioneers.clear();
-                        pioneers.push_back(Config::DEFAULT_PIONEER);
-                        pioneers_source = "default";
-                        save_pioneers_file();
-                    }
+                    pioneers.reset({Config::DEFAULT_PIONEER}, "default");
+                    save_pioneers_file();
+                    // Next gate sync has to start from scratch
+                    reset_gate_versions();
                     current_page = PAGE_MAIN;
                     return true;
                 }
             }
 
+            if (current_page == PAGE_MAIN) {
+                std::lock_guard<std::mutex> lk(posts_mutex);
+                if (feed_view.on_event(event, posts_cache.size(), card_height)) return true;
+            }
+
             if (current_page == PAGE_NEW_POST) {
                 if (event == Event::Return && !input_text.empty()) {
-                    loading = true;
-                    std::string post_copy = input_text;
+                    // The post is in the outbox right away, the feed stays usable
                     current_page = PAGE_MAIN;
-                    std::thread([&, post_copy]() {
-                        if (send_post_to_all(post_copy)) {
-                            status_msg = "✓ Post published to TORSPER";
-                            fetch_posts();
-                        } else {
-                            status_msg = "✗ Failed to publish post";
-                        }
-                        loading = false;
-                        screen.PostEvent(Event::Custom);
-                    }).detach();
+                    status_msg = "⌛ Publishing...";
+                    executor.spawn(report_to_ui<PublishResult>(&screen, &redraw, send_post_to_all(input_text),
+                        [&](PublishResult result) {
+                            switch (result) {
+                            case PublishResult::PUBLISHED:
+                                status_msg = "✓ Post published to TORSPER";
+                                executor.spawn(fetch_posts_async(feed_changed));
+                                break;
+                            case PublishResult::QUEUED:
+                                status_msg = "✓ Post saved, delivery continues in background";
+                                break;
+                            case PublishResult::FAILED:
+                                status_msg = "✗ Failed to save post";
+                                break;
+                            }
+                        }));
                     return true;
                 } else if (event == Event::Escape) {
                     current_page = PAGE_MAIN;
@@ -412,43 +511,19 @@ int main(int argc, char* argv[]) {
             return false;
         });
 
-        std::thread loading_thread([&]() {
-            while (current_page.load() == PAGE_GATE_INPUT) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                screen.PostEvent(Event::Custom);
-            }
-
-            auto start = std::chrono::steady_clock::now();
-
-            while (true) {
-                auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                    std::chrono::steady_clock::now() - start
-                ).count();
-                bool min_time = elapsed >= 2000;
-                if (min_time && tor_ready.load()) {
-                    std::thread([&]() {
-                        std::cerr << "[INFO] Updating pioneers list from gates...\n";
-                        if (update_pioneers_from_gates()) {
-                            std::cerr << "[SUCCESS] Pioneers updated successfully\n";
-                        } else {
-                            std::cerr << "[INFO] Using existing pioneers list\n";
-                        }
-                        screen.PostEvent(Event::Custom);
-                    }).detach();
-
-                    std::this_thread::sleep_for(std::chrono::milliseconds(300));
-                    current_page = PAGE_MAIN;
-                    screen.PostEvent(Event::Custom);
-                    break;
-                }
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                screen.PostEvent(Event::Custom);
-            }
-        });
-
+        redraw.start(&screen);
         screen.Loop(renderer);
-
-        if (tor_thread.joinable()) tor_thread.join();
+        redraw.stop();
+
+        // A bootstrap still running gives up, then the outbox, which it
+        // starts and which runs on the executor. Transfers still running
+        // are cancelled with the executor's token.
+        tor_thread.request_stop();
+        tor_thread.join();
+        wait_background_writes();
+        executor.shutdown();
+        CurlReactor::instance().shutdown();
+        CurlPool::instance().shutdown();
         curl_global_cleanup();
 
     } catch (const std::exception& e) {
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/feed/feed.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace {
+
+const std::string_view POST_DELIMITER = "\n---END---\n";
+
+std::string_view trim(std::string_view s) {
+    auto is_space = [](unsigned char ch) { return std::isspace(ch) != 0; };
+    while (!s.empty() && is_space(s.front())) s.remove_prefix(1);
+    while (!s.empty() && is_space(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+} // namespace
+
+uint64_t post_hash(std::string_view text) {
+    uint64_t h = 14695981039346656037ull;
+    for (unsigned char c : text) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+FeedMerger::FeedMerger(std::vector<FeedPost>& out) : out_(out) {
+    index_.reserve(out_.size());
+    for (size_t i = 0; i < out_.size(); ++i) {
+        index_.emplace(out_[i].hash, i);
+    }
+}
+
+bool FeedMerger::add(std::string text) {
+    uint64_t h = post_hash(text);
+
+    // Same hash is practically always the same post, compare to be sure
+    auto range = index_.equal_range(h);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (out_[it->second].text == text) return false;
+    }
+
+    index_.emplace(h, out_.size());
+    out_.push_back({h, std::move(text)});
+    return true;
+}
+
+bool FeedMerger::contains(const std::string& text) const {
+    auto range = index_.equal_range(post_hash(text));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (out_[it->second].text == text) return true;
+    }
+    return false;
+}
+
+PostStreamParser::PostStreamParser(Sink sink) : sink_(std::move(sink)) {}
+
+void PostStreamParser::emit(std::string_view post) {
+    post = trim(post);
+    if (post.empty()) return;
+    emitted_++;
+    sink_(std::string(post));
+}
+
+void PostStreamParser::feed(std::string_view chunk) {
+    std::string_view data = chunk;
+    size_t scan_from = 0;
+    bool joined = !carry_.empty();
+
+    // A delimiter may straddle the boundary, so the carried tail is joined
+    // with the new chunk and the scan resumes just before the old end
+    if (joined) {
+        scan_from = carry_.size() >= POST_DELIMITER.size()
+                  ? carry_.size() - POST_DELIMITER.size() + 1 : 0;
+        carry_.append(chunk);
+        data = carry_;
+    }
+
+    size_t start = 0;
+    size_t pos;
+    while ((pos = data.find(POST_DELIMITER, std::max(start, scan_from))) != std::string_view::npos) {
+        if (!skipping_ && pos - start <= MAX_POST_SIZE) emit(data.substr(start, pos - start));
+        skipping_ = false;
+        start = pos + POST_DELIMITER.size();
+    }
+
+    std::string_view tail = data.substr(start);
+    if (tail.size() > MAX_POST_SIZE) {
+        // Keep just enough to spot the delimiter that ends it
+        skipping_ = true;
+        tail = tail.substr(tail.size() - (POST_DELIMITER.size() - 1));
+    }
+
+    if (joined) {
+        carry_.erase(0, tail.data() - carry_.data());
+    } else {
+        carry_.assign(tail);
+    }
+}
+
+void PostStreamParser::finish() {
+    if (!skipping_) emit(carry_);
+    carry_.clear();
+    skipping_ = false;
+}
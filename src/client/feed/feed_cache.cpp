@@ -0,0 +1,217 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/feed/feed_cache.hpp"
+#include "client/feed/feed.hpp"
+#include "client/config.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char MAGIC[8] = {'T', 'S', 'P', 'F', 'E', 'E', 'D', '1'};
+const char MAGIC_WINDOW[8] = {'T', 'S', 'P', 'F', 'E', 'E', 'D', 'W'};   // older posts dropped
+const size_t RECORD_HEADER = 12;
+
+std::mutex cache_mutex;     // serializes file access
+size_t persisted = 0;       // posts_cache entries already in the file
+size_t file_posts = 0;      // records in the file
+size_t file_bytes = 0;
+bool windowed = false;      // posts_cache was loaded without the older posts
+
+void put_le(std::string& out, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) out.push_back(static_cast<char>((v >> (8 * i)) & 0xff));
+}
+
+uint64_t get_le(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+void put_record(std::string& out, const FeedPost& post) {
+    put_le(out, post.hash, 8);
+    put_le(out, post.text.size(), 4);
+    out += post.text;
+}
+
+// Index of the oldest post kept: the newest ones that fit the cap
+size_t keep_from(const std::vector<FeedPost>& posts) {
+    size_t bytes = 0;
+    size_t i = posts.size();
+    while (i > 0 && posts.size() - i < Config::FEED_CACHE_MAX_POSTS) {
+        size_t record = RECORD_HEADER + posts[i - 1].text.size();
+        if (bytes + record > Config::FEED_CACHE_MAX_BYTES) break;
+        bytes += record;
+        --i;
+    }
+    return i;
+}
+
+// Replaces the file with `records`, through a temp file
+bool rewrite(const std::string& records, size_t count, bool trimmed) {
+    const std::string tmp = Config::FEED_CACHE_FILE + ".tmp";
+    try {
+        fs::create_directories(fs::path(Config::FEED_CACHE_FILE).parent_path());
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out) return false;
+            out.write(trimmed ? MAGIC_WINDOW : MAGIC, sizeof(MAGIC));
+            out.write(records.data(), static_cast<std::streamsize>(records.size()));
+            out.flush();
+            if (!out) return false;
+        }
+        fs::rename(tmp, Config::FEED_CACHE_FILE);
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to rewrite feed cache: " << e.what() << "\n";
+        return false;
+    }
+    file_posts = count;
+    file_bytes = records.size();
+    return true;
+}
+
+} // namespace
+
+size_t load_feed_cache() {
+    std::lock_guard<std::mutex> lk(cache_mutex);
+
+    std::string data;
+    try {
+        std::ifstream in(Config::FEED_CACHE_FILE, std::ios::binary);
+        if (!in) return 0;
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    } catch (...) {
+        return 0;
+    }
+
+    bool was_trimmed = data.size() >= sizeof(MAGIC) &&
+                       std::memcmp(data.data(), MAGIC_WINDOW, sizeof(MAGIC)) == 0;
+    if (!was_trimmed &&
+        (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)) {
+        std::cerr << "[WARN] Ignoring unreadable feed cache\n";
+        std::error_code ec;
+        fs::remove(Config::FEED_CACHE_FILE, ec);
+        return 0;
+    }
+
+    std::vector<FeedPost> loaded;
+    size_t pos = sizeof(MAGIC);
+    while (data.size() - pos >= RECORD_HEADER) {
+        uint64_t hash = get_le(data.data() + pos, 8);
+        size_t len = static_cast<size_t>(get_le(data.data() + pos + 8, 4));
+        if (data.size() - pos - RECORD_HEADER < len) break;
+
+        std::string text = data.substr(pos + RECORD_HEADER, len);
+        if (post_hash(text) != hash) break;
+
+        loaded.push_back({hash, std::move(text)});
+        pos += RECORD_HEADER + len;
+    }
+
+    if (pos != data.size()) {
+        // Crash in the middle of an append, keep the good prefix
+        std::cerr << "[WARN] Feed cache has a damaged tail, truncating\n";
+    }
+
+    // Older posts than the cap holds are dropped, a cut tail goes with the rewrite
+    size_t from = keep_from(loaded);
+    if (from > 0 || pos != data.size()) {
+        std::string records;
+        for (size_t i = from; i < loaded.size(); ++i) put_record(records, loaded[i]);
+        rewrite(records, loaded.size() - from, was_trimmed || from > 0);
+    } else {
+        file_posts = loaded.size();
+        file_bytes = pos - sizeof(MAGIC);
+    }
+
+    windowed = was_trimmed || from > 0;
+
+    std::lock_guard<std::mutex> plk(posts_mutex);
+    FeedMerger merger(posts_cache);
+    for (size_t i = from; i < loaded.size(); ++i) merger.add(std::move(loaded[i].text));
+    persisted = posts_cache.size();
+    return loaded.size() - from;
+}
+
+bool append_feed_cache() {
+    std::lock_guard<std::mutex> lk(cache_mutex);
+
+    // Copy the new records out, the file write happens without posts_mutex.
+    // Past twice the cap the file is rewritten to the newest posts instead.
+    std::string buf;
+    size_t upto;
+    size_t compact_count = 0;
+    {
+        std::lock_guard<std::mutex> plk(posts_mutex);
+        upto = posts_cache.size();
+        if (upto <= persisted) return true;
+        for (size_t i = persisted; i < upto; ++i) put_record(buf, posts_cache[i]);
+
+        if (file_posts + (upto - persisted) > 2 * Config::FEED_CACHE_MAX_POSTS ||
+            file_bytes + buf.size() > 2 * Config::FEED_CACHE_MAX_BYTES) {
+            buf.clear();
+            size_t from = keep_from(posts_cache);
+            for (size_t i = from; i < upto; ++i) put_record(buf, posts_cache[i]);
+            compact_count = upto - from;
+        }
+    }
+
+    if (compact_count > 0) {
+        if (!rewrite(buf, compact_count, true)) return false;
+        persisted = upto;
+        return true;
+    }
+
+    try {
+        fs::create_directories(fs::path(Config::FEED_CACHE_FILE).parent_path());
+        bool fresh = !fs::exists(Config::FEED_CACHE_FILE) || fs::file_size(Config::FEED_CACHE_FILE) == 0;
+
+        std::ofstream out(Config::FEED_CACHE_FILE, std::ios::binary | std::ios::app);
+        if (!out) return false;
+        if (fresh) {
+            out.write(windowed ? MAGIC_WINDOW : MAGIC, sizeof(MAGIC));
+            file_posts = 0;
+            file_bytes = 0;
+        }
+        out.write(buf.data(), static_cast<std::streamsize>(buf.size()));
+        out.flush();
+        if (!out) return false;
+    } catch (const std::exception& e) {
+        std::cerr << "[ERROR] Failed to write feed cache: " << e.what() << "\n";
+        return false;
+    }
+
+    file_posts += upto - persisted;
+    file_bytes += buf.size();
+    persisted = upto;
+    return true;
+}
+
+bool feed_cache_windowed() {
+    std::lock_guard<std::mutex> lk(cache_mutex);
+    return windowed;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/network/curl_pool.hpp"
+#include "client/config.hpp"
+
+std::string url_host(const std::string& url) {
+    size_t start = url.find("://");
+    start = (start == std::string::npos) ? 0 : start + 3;
+    size_t end = url.find('/', start);
+    return url.substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+CurlPool& CurlPool::instance() {
+    static CurlPool pool;
+    return pool;
+}
+
+CurlPool::CurlPool() {
+    share_ = curl_share_init();
+    if (!share_) return;
+
+    curl_share_setopt(share_, CURLSHOPT_LOCKFUNC, &CurlPool::lock_cb);
+    curl_share_setopt(share_, CURLSHOPT_UNLOCKFUNC, &CurlPool::unlock_cb);
+    curl_share_setopt(share_, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share_, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+CurlPool::~CurlPool() {
+    shutdown();
+}
+
+void CurlPool::lock_cb(CURL*, curl_lock_data data, curl_lock_access, void* userptr) {
+    static_cast<CurlPool*>(userptr)->share_locks_[data].lock();
+}
+
+void CurlPool::unlock_cb(CURL*, curl_lock_data data, void* userptr) {
+    static_cast<CurlPool*>(userptr)->share_locks_[data].unlock();
+}
+
+CURL* CurlPool::acquire(const std::string& url) {
+    CURL* easy = nullptr;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto it = idle_.find(url_host(url));
+        if (it != idle_.end() && !it->second.empty()) {
+            easy = it->second.back();
+            it->second.pop_back();
+        }
+    }
+
+    if (easy) {
+        // Drops the previous options, keeps connections and caches
+        curl_easy_reset(easy);
+    } else {
+        easy = curl_easy_init();
+        if (!easy) return nullptr;
+    }
+
+    curl_easy_setopt(easy, CURLOPT_PROXY, Config::SOCKS_PROXY.c_str());
+    curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (share_) curl_easy_setopt(easy, CURLOPT_SHARE, share_);
+    return easy;
+}
+
+void CurlPool::release(const std::string& url, CURL* easy) {
+    if (!easy) return;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (share_) {
+            auto& list = idle_[url_host(url)];
+            if (list.size() < MAX_IDLE_PER_HOST) {
+                list.push_back(easy);
+                return;
+            }
+        }
+    }
+    curl_easy_cleanup(easy);
+}
+
+void CurlPool::shutdown() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (auto& [host, list] : idle_) {
+        for (CURL* easy : list) curl_easy_cleanup(easy);
+    }
+    idle_.clear();
+
+    if (share_) {
+        curl_share_cleanup(share_);
+        share_ = nullptr;
+    }
+}
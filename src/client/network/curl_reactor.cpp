@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#include "client/network/curl_reactor.hpp"
+
+#include <algorithm>
+#include <memory>
+
+CurlReactor& CurlReactor::instance() {
+    static CurlReactor reactor;
+    return reactor;
+}
+
+CurlReactor::CurlReactor() {
+    multi_ = curl_multi_init();
+    if (!multi_) {
+        // Every transfer fails at once instead
+        stopping_ = true;
+        return;
+    }
+    thread_ = std::thread(&CurlReactor::loop, this);
+}
+
+CurlReactor::~CurlReactor() {
+    shutdown();
+}
+
+uint64_t CurlReactor::add(CURL* easy, DoneFn done) {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (!stopping_) {
+            uint64_t id = next_id_++;
+            added_.push_back({id, easy, std::move(done)});
+            curl_multi_wakeup(multi_);
+            return id;
+        }
+    }
+    done(CURLE_FAILED_INIT);
+    return 0;
+}
+
+void CurlReactor::remove(uint64_t id) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (stopping_ || id == 0) return;
+    removed_.push_back(id);
+    curl_multi_wakeup(multi_);
+}
+
+Task<CURLcode> CurlReactor::perform(CURL* easy, CancellationToken token) {
+    struct State {
+        AsyncEvent done;
+        CURLcode code = CURLE_OK;
+    };
+    auto state = std::make_shared<State>();
+
+    uint64_t id = add(easy, [state](CURLcode code) {
+        state->code = code;
+        state->done.set();
+    });
+    if (!co_await state->done.wait(token)) {
+        // curl may still write into the caller's buffers until it lets go
+        remove(id);
+        co_await state->done.wait();
+    }
+    co_return state->code;
+}
+
+void CurlReactor::shutdown() {
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        stopping_ = true;
+        if (multi_ && thread_.joinable()) curl_multi_wakeup(multi_);
+    }
+    if (thread_.joinable()) thread_.join();
+    if (multi_) {
+        curl_multi_cleanup(multi_);
+        multi_ = nullptr;
+    }
+}
+
+void CurlReactor::finish(CURL* easy, CURLcode code) {
+    auto it = running_.find(easy);
+    if (it == running_.end()) return;
+    curl_multi_remove_handle(multi_, easy);
+    DoneFn done = std::move(it->second.done);
+    running_.erase(it);
+    done(code);
+}
+
+void CurlReactor::loop() {
+    for (;;) {
+        std::vector<Added> added;
+        std::vector<uint64_t> removed;
+        bool stop;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            added.swap(added_);
+            removed.swap(removed_);
+            stop = stopping_;
+        }
+
+        for (auto& a : added) {
+            if (curl_multi_add_handle(multi_, a.easy) != CURLM_OK) {
+                a.done(CURLE_FAILED_INIT);
+                continue;
+            }
+            running_.emplace(a.easy, Running{a.id, std::move(a.done)});
+        }
+
+        std::vector<CURL*> aborted;
+        for (const auto& [easy, r] : running_) {
+            if (stop || std::find(removed.begin(), removed.end(), r.id) != removed.end()) {
+                aborted.push_back(easy);
+            }
+        }
+        for (CURL* easy : aborted) finish(easy, CURLE_ABORTED_BY_CALLBACK);
+        if (stop) return;
+
+        int still_running = 0;
+        curl_multi_perform(multi_, &still_running);
+
+        int queued = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &queued)) {
+            if (msg->msg != CURLMSG_DONE) continue;
+            // The message goes away with the handle, copy it first
+            CURL* easy = msg->easy_handle;
+            CURLcode code = msg->data.result;
+            finish(easy, code);
+        }
+
+        // Sockets, curl's own timers, or add()/remove()/shutdown() wake it
+        curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+    }
+}
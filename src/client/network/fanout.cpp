@@ -0,0 +1,374 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/network/fanout.hpp"
+#include "client/network/network.hpp"
+#include "client/network/curl_pool.hpp"
+#include "client/network/curl_reactor.hpp"
+#include "client/network/host_health.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+using clock_type = std::chrono::steady_clock;
+
+namespace {
+
+// Write target of a streamed request
+struct StreamSink {
+    const FanoutRequest* req = nullptr;
+    CURL* easy = nullptr;
+};
+
+size_t stream_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    StreamSink* sink = static_cast<StreamSink*>(userdata);
+    long http_code = 0;
+    curl_easy_getinfo(sink->easy, CURLINFO_RESPONSE_CODE, &http_code);
+    sink->req->on_chunk(static_cast<int>(http_code), std::string_view(ptr, size * nmemb));
+    return size * nmemb;
+}
+
+CURL* make_easy(const FanoutRequest& req, FanoutResult& result, StreamSink& sink) {
+    CURL* curl = CurlPool::instance().acquire(req.url);
+    if (!curl) return nullptr;
+
+    curl_easy_setopt(curl, CURLOPT_URL, req.url.c_str());
+    if (req.on_chunk) {
+        sink = {&req, curl};
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stream_cb);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &sink);
+    } else {
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &result.body);
+    }
+    // The adaptive timeout bounds getting an answer. A streamed feed may
+    // take much longer than that in total, it only fails once it stalls.
+    long timeout = req.timeout_ms > 0 ? req.timeout_ms
+                                      : HostHealth::instance().timeout_ms(url_host(req.url));
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT_MS, timeout);
+    if (req.on_chunk) {
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, HostHealth::STALL_BYTES_PER_S);
+        curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, std::max(1L, (timeout + 999) / 1000));
+    } else {
+        curl_easy_setopt(curl, CURLOPT_TIMEOUT_MS, timeout);
+    }
+
+    if (req.post_body) {
+        curl_easy_setopt(curl, CURLOPT_POST, 1L);
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req.post_body->c_str());
+        curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(req.post_body->size()));
+    }
+    return curl;
+}
+
+// Transfers of one fan-out, run by the CurlReactor. close() must be awaited
+// before it goes away: it cancels whatever still runs and waits until curl
+// let go of it.
+class MultiRunner {
+public:
+    struct Transfer {
+        CURL* easy = nullptr;
+        uint64_t id = 0;            // CurlReactor transfer
+        size_t index = 0;
+        clock_type::time_point started;
+        bool hedged = false;        // a backup has already been fired for it
+        bool probe = false;         // the half-open probe of its host
+    };
+
+    MultiRunner(const std::vector<FanoutRequest>& requests, std::vector<FanoutResult>& results)
+        : requests_(requests), results_(results), sinks_(requests.size()),
+          shared_(std::make_shared<Shared>()) {}
+
+    MultiRunner(const MultiRunner&) = delete;
+    MultiRunner& operator=(const MultiRunner&) = delete;
+
+    // Starts request i. Returns false when it finished right away
+    // (open circuit or no handle), with the result already filled in.
+    bool start(size_t i) {
+        FanoutResult& r = results_[i];
+        bool probe = false;
+        if (!HostHealth::instance().allow(url_host(requests_[i].url), &probe)) {
+            r.done = true;
+            r.skipped = true;
+            r.code = CURLE_COULDNT_CONNECT;
+            return false;
+        }
+
+        CURL* easy = make_easy(requests_[i], r, sinks_[i]);
+        if (!easy) {
+            if (probe) HostHealth::instance().abandon(url_host(requests_[i].url));
+            r.done = true;
+            r.code = CURLE_FAILED_INIT;
+            return false;
+        }
+
+        active_.push_back({easy, 0, i, clock_type::now(), false, probe});
+        auto shared = shared_;
+        active_.back().id = CurlReactor::instance().add(easy, [shared, i](CURLcode code) {
+            {
+                std::lock_guard<std::mutex> lk(shared->mtx);
+                shared->finished.push_back({i, code, clock_type::now()});
+            }
+            shared->ready.set();
+        });
+        return true;
+    }
+
+    std::vector<Transfer>& active() { return active_; }
+
+    // Waits until transfers finished, `wait` passed or `token` was
+    // cancelled. Returns the indexes that finished.
+    Task<std::vector<size_t>> step(std::optional<std::chrono::milliseconds> wait, CancellationToken token) {
+        auto finished = take();
+        if (finished.empty() && !active_.empty()) {
+            if (wait) {
+                co_await shared_->ready.wait_for(*wait, token);
+            } else {
+                co_await shared_->ready.wait(token);
+            }
+            finished = take();
+        }
+
+        std::vector<size_t> indexes;
+        for (const auto& f : finished) {
+            if (complete(f)) indexes.push_back(f.index);
+        }
+        co_return indexes;
+    }
+
+    // Cancels the transfers still running, their results stay not done
+    Task<> close() {
+        for (const auto& t : active_) CurlReactor::instance().remove(t.id);
+
+        while (!active_.empty()) {
+            for (const auto& f : take()) {
+                auto it = find(f.index);
+                if (it == active_.end()) continue;
+                CurlPool::instance().release(requests_[it->index].url, it->easy);
+
+                // A cancelled probe says nothing about the host, the next
+                // caller gets to probe it instead
+                if (it->probe) HostHealth::instance().abandon(url_host(requests_[it->index].url));
+                active_.erase(it);
+            }
+            if (!active_.empty()) co_await shared_->ready.wait();
+        }
+    }
+
+private:
+    struct Finished {
+        size_t index;
+        CURLcode code;
+        clock_type::time_point at;
+    };
+
+    // Filled on the reactor thread
+    struct Shared {
+        std::mutex mtx;
+        std::vector<Finished> finished;
+        AsyncEvent ready;
+    };
+
+    std::vector<Finished> take() {
+        std::lock_guard<std::mutex> lk(shared_->mtx);
+        // A completion after this sets it again, one before leaves it set
+        // for nothing, which only costs a loop
+        shared_->ready.reset();
+        return std::exchange(shared_->finished, {});
+    }
+
+    std::vector<Transfer>::iterator find(size_t index) {
+        return std::find_if(active_.begin(), active_.end(),
+            [&](const Transfer& t) { return t.index == index; });
+    }
+
+    bool complete(const Finished& f) {
+        auto it = find(f.index);
+        if (it == active_.end()) return false;
+
+        FanoutResult& r = results_[it->index];
+        r.done = true;
+        r.code = f.code;
+        r.elapsed_ms = static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            f.at - it->started).count());
+        long latency_ms = r.elapsed_ms;
+        if (r.code == CURLE_OK) {
+            long http_code = 0;
+            curl_easy_getinfo(it->easy, CURLINFO_RESPONSE_CODE, &http_code);
+            r.status = static_cast<int>(http_code);
+
+            // A stream's length says nothing about the host, its first
+            // byte does
+            curl_off_t first_byte_us = 0;
+            if (requests_[it->index].on_chunk &&
+                curl_easy_getinfo(it->easy, CURLINFO_STARTTRANSFER_TIME_T, &first_byte_us) == CURLE_OK) {
+                latency_ms = static_cast<long>(first_byte_us / 1000);
+            }
+        }
+
+        // Any HTTP answer means the host is alive. A transfer the reactor
+        // dropped on shutdown tells nothing.
+        const std::string host = url_host(requests_[it->index].url);
+        if (r.code == CURLE_OK && r.status > 0) {
+            HostHealth::instance().record_success(host, latency_ms);
+        } else if (r.code == CURLE_ABORTED_BY_CALLBACK || r.code == CURLE_FAILED_INIT) {
+            if (it->probe) HostHealth::instance().abandon(host);
+        } else {
+            HostHealth::instance().record_failure(host);
+        }
+
+        CurlPool::instance().release(requests_[it->index].url, it->easy);
+        active_.erase(it);
+        return true;
+    }
+
+    const std::vector<FanoutRequest>& requests_;
+    std::vector<FanoutResult>& results_;
+    std::vector<StreamSink> sinks_;     // sized up front, curl keeps pointers into it
+    std::shared_ptr<Shared> shared_;
+    std::vector<Transfer> active_;
+};
+
+std::vector<FanoutResult> make_results(size_t n) {
+    std::vector<FanoutResult> results(n);
+    for (size_t i = 0; i < n; ++i) results[i].index = i;
+    return results;
+}
+
+} // namespace
+
+Task<std::vector<FanoutResult>> fanout(const std::vector<FanoutRequest>& requests,
+                                       FanoutCallback on_done,
+                                       size_t max_parallel,
+                                       CancellationToken token) {
+    auto results = make_results(requests.size());
+    if (requests.empty()) co_return results;
+
+    MultiRunner runner(requests, results);
+    max_parallel = std::max<size_t>(1, max_parallel);
+    size_t next = 0;
+    bool cancelled = false;
+    std::exception_ptr error;
+
+    // The transfers have to be closed before an exception leaves
+    auto report = [&](size_t i) {
+        if (!on_done || cancelled) return;
+        try {
+            if (!on_done(results[i])) cancelled = true;
+        } catch (...) {
+            error = std::current_exception();
+            cancelled = true;
+        }
+    };
+
+    while (!cancelled && !token.cancelled()) {
+        while (!cancelled && next < requests.size() && runner.active().size() < max_parallel) {
+            size_t i = next++;
+            if (!runner.start(i)) report(i);
+        }
+        if (runner.active().empty()) break;
+
+        for (size_t i : co_await runner.step(std::nullopt, token)) report(i);
+    }
+
+    // Drops whatever is still in flight after a cancel
+    co_await runner.close();
+    if (error) std::rethrow_exception(error);
+    co_return results;
+}
+
+Task<std::vector<FanoutResult>> fanout_first_k(const std::vector<FanoutRequest>& requests,
+                                               size_t k,
+                                               const std::vector<long>& hedge_after_ms,
+                                               FanoutCallback on_done,
+                                               CancellationToken token) {
+    auto results = make_results(requests.size());
+    if (requests.empty() || k == 0) co_return results;
+
+    MultiRunner runner(requests, results);
+    size_t next = 0;
+    size_t succeeded = 0;
+    std::exception_ptr error;
+
+    auto report = [&](size_t i) {
+        if (!on_done || error) return;
+        try {
+            on_done(results[i]);
+        } catch (...) {
+            error = std::current_exception();
+        }
+    };
+
+    // Starts the next candidate that actually goes on the wire
+    auto launch_next = [&]() {
+        while (next < requests.size()) {
+            size_t i = next++;
+            if (runner.start(i)) return true;
+            report(i);
+        }
+        return false;
+    };
+
+    for (size_t i = 0; i < k; ++i) {
+        if (!launch_next()) break;
+    }
+
+    while (succeeded < k && !runner.active().empty() && !error && !token.cancelled()) {
+        // Hedge: a replica slower than its host usually is gets a backup
+        auto now = clock_type::now();
+        std::optional<std::chrono::milliseconds> wait;
+        for (size_t a = 0; a < runner.active().size(); ++a) {
+            auto& t = runner.active()[a];
+            if (t.hedged) continue;
+
+            long delay = t.index < hedge_after_ms.size() ? hedge_after_ms[t.index] : 0;
+            auto deadline = t.started + std::chrono::milliseconds(delay);
+            if (now >= deadline) {
+                t.hedged = true;
+                if (next < requests.size()) {
+                    std::cerr << "[INFO] Hedging slow replica " << requests[t.index].url << "\n";
+                }
+                launch_next();
+            } else {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now) +
+                            std::chrono::milliseconds(1);
+                if (!wait || left < *wait) wait = left;
+            }
+        }
+
+        for (size_t i : co_await runner.step(wait, token)) {
+            if (results[i].ok()) {
+                succeeded++;
+            } else {
+                // Replace a failed replica right away
+                launch_next();
+            }
+            report(i);
+        }
+    }
+
+    // Cancels the slower replicas still running
+    co_await runner.close();
+    if (error) std::rethrow_exception(error);
+    co_return results;
+}
@@ -0,0 +1,138 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/network/host_health.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+using clock_type = std::chrono::steady_clock;
+
+HostHealth& HostHealth::instance() {
+    static HostHealth health;
+    return health;
+}
+
+bool HostHealth::allow(const std::string& host, bool* probe) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    HostStats& h = hosts_[host];
+    if (probe) *probe = false;
+
+    switch (h.state) {
+    case BreakerState::CLOSED:
+        return true;
+    case BreakerState::OPEN:
+        if (clock_type::now() < h.open_until) return false;
+        h.state = BreakerState::HALF_OPEN;
+        h.probe_in_flight = true;
+        if (probe) *probe = true;
+        std::cerr << "[INFO] Probing " << host << " after cooldown\n";
+        return true;
+    case BreakerState::HALF_OPEN:
+        if (h.probe_in_flight) return false;
+        h.probe_in_flight = true;
+        if (probe) *probe = true;
+        return true;
+    }
+    return true;
+}
+
+long HostHealth::timeout_ms(const std::string& host) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = hosts_.find(host);
+    if (it == hosts_.end() || it->second.samples == 0) return DEFAULT_TIMEOUT_MS;
+
+    const HostStats& h = it->second;
+    double t = TIMEOUT_FACTOR * (h.latency_ms + 4 * h.deviation_ms);
+    return std::clamp(static_cast<long>(t), MIN_TIMEOUT_MS, MAX_TIMEOUT_MS);
+}
+
+double HostHealth::score(const std::string& host) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = hosts_.find(host);
+    if (it == hosts_.end() || it->second.samples == 0) return DEFAULT_TIMEOUT_MS / 2.0;
+
+    const HostStats& h = it->second;
+    if (h.state == BreakerState::OPEN) return 1e12;
+    return h.latency_ms * (1 + 4 * h.error_rate);
+}
+
+long HostHealth::hedge_after_ms(const std::string& host) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = hosts_.find(host);
+    if (it == hosts_.end() || it->second.samples == 0) return DEFAULT_HEDGE_MS;
+
+    const HostStats& h = it->second;
+    return std::max(MIN_HEDGE_MS, static_cast<long>(h.latency_ms + 2 * h.deviation_ms));
+}
+
+void HostHealth::record_success(const std::string& host, long elapsed_ms) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    HostStats& h = hosts_[host];
+    double sample = static_cast<double>(elapsed_ms);
+
+    if (h.samples == 0) {
+        h.latency_ms = sample;
+        h.deviation_ms = sample / 2;
+    } else {
+        h.deviation_ms += ALPHA * (std::abs(sample - h.latency_ms) - h.deviation_ms);
+        h.latency_ms += ALPHA * (sample - h.latency_ms);
+    }
+    h.samples++;
+    h.error_rate *= (1 - ALPHA);
+
+    if (h.state != BreakerState::CLOSED) {
+        std::cerr << "[INFO] " << host << " is back, closing circuit\n";
+    }
+    h.consecutive_failures = 0;
+    h.state = BreakerState::CLOSED;
+    h.cooldown = std::chrono::milliseconds(0);
+    h.probe_in_flight = false;
+}
+
+void HostHealth::record_failure(const std::string& host) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    HostStats& h = hosts_[host];
+
+    h.error_rate += ALPHA * (1 - h.error_rate);
+    h.consecutive_failures++;
+    h.probe_in_flight = false;
+    if (h.state == BreakerState::OPEN) return;   // late answer from before the trip
+
+    bool failed_probe = h.state == BreakerState::HALF_OPEN;
+    if (failed_probe || h.consecutive_failures >= FAILURES_TO_OPEN) {
+        h.cooldown = failed_probe ? std::min(h.cooldown * 2, MAX_COOLDOWN) : first_cooldown_;
+        h.state = BreakerState::OPEN;
+        h.open_until = clock_type::now() + h.cooldown;
+        std::cerr << "[WARN] Circuit open for " << host << " ("
+                  << h.cooldown.count() / 1000 << "s)\n";
+    }
+}
+
+void HostHealth::abandon(const std::string& host) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    auto it = hosts_.find(host);
+    if (it != hosts_.end() && it->second.state == BreakerState::HALF_OPEN) {
+        it->second.probe_in_flight = false;
+    }
+}
+
+HostStats HostHealth::stats(const std::string& host) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return hosts_[host];
+}
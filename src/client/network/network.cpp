@@ -19,10 +19,23 @@
 #include <iostream>
 #include <sstream>
 #include <algorithm>
+#include <unordered_set>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
 
 #include "client/network/network.hpp"
+#include "client/network/fanout.hpp"
+#include "client/network/curl_pool.hpp"
+#include "client/network/curl_reactor.hpp"
+#include "client/network/host_health.hpp"
+#include "client/network/outbox.hpp"
+#include "client/async/executor.hpp"
 #include "client/config.hpp"
+#include "client/feed/feed_cache.hpp"
 #include "client/pionniers/pionniers.hpp"
+#include "utils/onion/onion_address.hpp"
 
 size_t write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
     std::string* out = static_cast<std::string*>(userdata);
@@ -30,167 +43,345 @@ size_t write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
     return size * nmemb;
 }
 
-std::pair<int, std::string> fetch_url_with_status(const std::string &url) {
-    CURL *curl = curl_easy_init();
-    if (!curl) return std::make_pair(0, std::string());
+Task<std::pair<int, std::string>> fetch_url_with_status(std::string url) {
+    const std::string host = url_host(url);
+    HostHealth &health = HostHealth::instance();
+    bool probe = false;
+    if (!health.allow(host, &probe)) co_return std::make_pair(0, std::string());
+
+    PooledCurl curl(url);
+    if (!curl) {
+        if (probe) health.abandon(host);
+        co_return std::make_pair(0, std::string());
+    }
 
     std::string response;
     long http_code = 0;
 
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_cb);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(curl, CURLOPT_PROXY, "socks5h://127.0.0.1:9050");
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+    curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, write_cb);
+    curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
+    long timeout = health.timeout_ms(host);
+    curl_easy_setopt(curl.get(), CURLOPT_CONNECTTIMEOUT_MS, timeout);
+    curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT_MS, timeout);
 
-    CURLcode res = curl_easy_perform(curl);
+    auto started = std::chrono::steady_clock::now();
+    CURLcode res = co_await CurlReactor::instance().perform(curl.get());
     if (res == CURLE_OK) {
-        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &http_code);
+        health.record_success(host, static_cast<long>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started).count()));
+    } else if (res == CURLE_ABORTED_BY_CALLBACK || res == CURLE_FAILED_INIT) {
+        // Cancelled, says nothing about the host
+        if (probe) health.abandon(host);
+    } else {
+        health.record_failure(host);
     }
 
-    curl_easy_cleanup(curl);
-    return std::make_pair(static_cast<int>(http_code), response);
+    co_return std::make_pair(static_cast<int>(http_code), response);
 }
 
-std::vector<std::string> fetch_servers_from_gates() {
+Task<std::vector<std::string>> fetch_servers_from_gates() {
+    std::vector<FanoutRequest> requests;
+    for (const auto &gate : gates) {
+        requests.push_back({.url = "http://" + gate + "/get_pionniers"});
+    }
+
     std::vector<std::string> servers;
+    std::unordered_set<std::string> seen;
 
-    for (const auto &gate : gates) {
-        std::string url = "http://" + gate + "/get_pionniers";
-        std::pair<int, std::string> result = fetch_url_with_status(url);
-        int status = result.first;
-        std::string resp = result.second;
-
-        if (status != 200 || resp.empty()) continue;
-
-        std::stringstream ss(std::move(resp));
-        std::string line;
-        while (std::getline(ss, line)) {
-            // trim
-            line.erase(line.begin(), std::find_if(line.begin(), line.end(),
-                [](unsigned char ch){ return !std::isspace(ch); }));
-            line.erase(std::find_if(line.rbegin(), line.rend(),
-                [](unsigned char ch){ return !std::isspace(ch); }).base(), line.end());
-
-            if (!line.empty() && line.find(".onion") != std::string::npos) {
-                if (std::find(servers.begin(), servers.end(), line) == servers.end()) {
-                    servers.push_back(line);
-                }
+    for (const auto &r : co_await fanout(requests)) {
+        if (!r.ok() || r.status != 200 || r.body.empty()) continue;
+
+        for (const auto &onion : parse_lines(r.body)) {
+            std::string server = onion.to_string();
+            if (seen.insert(server).second) {
+                servers.push_back(std::move(server));
             }
         }
     }
 
-    return servers;
+    co_return servers;
 }
 
-bool fetch_posts() {
-    posts_cache.clear();
+std::string pioneers_delta_url(const std::string &gate, uint64_t epoch, uint64_t version) {
+    return "http://" + gate + "/get_pionniers?since=" + std::to_string(version) +
+           "&epoch=" + std::to_string(epoch);
+}
 
-    std::vector<std::string> servers;
-    {
-        std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-        servers = pioneers;
+GateDelta parse_pioneers_delta(const std::string &resp) {
+    GateDelta delta;
+    std::stringstream ss(resp);
+    std::string line;
+
+    // Header: "<full|delta> <epoch> <version> [federated]"
+    std::string kind, flag;
+    if (!std::getline(ss, line)) return delta;
+    std::stringstream header(line);
+    if (!(header >> kind >> delta.epoch >> delta.version) ||
+        (kind != "full" && kind != "delta")) {
+        return delta;
+    }
+    delta.full = (kind == "full");
+    delta.federated = (header >> flag) && flag == "federated";
+
+    while (std::getline(ss, line)) {
+        line.erase(std::find_if(line.rbegin(), line.rend(),
+            [](unsigned char ch){ return !std::isspace(ch); }).base(), line.end());
+        if (line.size() < 2) continue;
+        auto onion = OnionAddress::parse(std::string_view(line).substr(1));
+        if (!onion) continue;
+
+        if (line[0] == '+') delta.added.push_back(*onion);
+        else if (line[0] == '-') delta.removed.push_back(*onion);
+    }
+
+    delta.ok = true;
+    return delta;
+}
+
+Task<GateDelta> fetch_legacy_pioneers(std::string gate) {
+    GateDelta delta;
+    auto [status, resp] = co_await fetch_url_with_status("http://" + gate + "/get_pionniers");
+    if (status != 200) co_return delta;
+
+    delta.ok = true;
+    delta.full = true;
+    delta.added = parse_lines(resp);
+    co_return delta;
+}
+
+Task<GateDelta> fetch_pioneers_delta(std::string gate, uint64_t epoch, uint64_t version) {
+    auto [status, resp] = co_await fetch_url_with_status(pioneers_delta_url(gate, epoch, version));
+
+    if (status == 404) {
+        // Old gate without delta support, take the plain list
+        co_return co_await fetch_legacy_pioneers(gate);
+    }
+    if (status != 200 || resp.empty()) {
+        std::cerr << "[WARN] " << gate << " returned HTTP " << status << " for delta\n";
+        co_return GateDelta();
+    }
+
+    GateDelta delta = parse_pioneers_delta(resp);
+    if (!delta.ok) {
+        std::cerr << "[WARN] " << gate << " sent malformed delta header\n";
     }
+    co_return delta;
+}
 
-    if (servers.empty()) {
+// Only through fetch_posts_async, which runs one refresh at a time: each
+// merger indexes the feed it started from
+static Task<bool> fetch_posts(std::function<void()> on_update) {
+    auto directory = pioneers.snapshot();
+    if (directory->empty()) {
         std::cerr << "[ERROR] No pioneers available for fetching posts\n";
-        return false;
+        co_return false;
     }
 
-    std::cerr << "[INFO] Fetching from " << servers.size() << " pioneer(s)\n";
+    // Best scored pioneers first
+    HostHealth &health = HostHealth::instance();
+    struct Ranked {
+        double score;
+        const OnionAddress *address;
+        std::string host;
+    };
+    std::vector<Ranked> ranked;
+    ranked.reserve(directory->size());
+    for (const auto &p : directory->list) {
+        std::string host = p.address.to_string();
+        double score = health.score(host);
+        ranked.push_back({score, &p.address, std::move(host)});
+    }
+    std::stable_sort(ranked.begin(), ranked.end(),
+        [](const auto &a, const auto &b) { return a.score < b.score; });
 
-    bool any_success = false;
-    const std::string delimiter = "\n---END---\n";
+    // Posts go into the feed as they arrive. Pioneers never delete posts, so
+    // the feed only grows and every pioneer's copy is merged into it once.
+    size_t before;
+    std::unique_ptr<FeedMerger> merger;
+    {
+        std::lock_guard<std::mutex> lk(posts_mutex);
+        before = posts_cache.size();
+        merger = std::make_unique<FeedMerger>(posts_cache);
+    }
+
+    // Redraws are throttled, a large feed arrives in many small chunks
+    using clock_type = std::chrono::steady_clock;
+    const auto redraw_every = std::chrono::milliseconds(100);
+    clock_type::time_point last_redraw{};
+    bool pending_redraw = false;
+
+    // A trimmed cache holds only the newest posts. Pioneers send their feed
+    // oldest first, so whatever comes before the first post the feed already
+    // has is older than the cache and is held back. It is added only if that
+    // pioneer shares no post with the feed at all.
+    struct Window {
+        bool reached;
+        std::vector<std::string> held;
+    };
+    std::vector<Window> windows(ranked.size(), Window{!feed_cache_windowed(), {}});
+
+    auto on_post = [&](Window &w, std::string post) {
+        std::lock_guard<std::mutex> lk(posts_mutex);
+        if (!w.reached) {
+            if (!merger->contains(post)) {
+                w.held.push_back(std::move(post));
+                return;
+            }
+            w.reached = true;
+            w.held.clear();
+        }
+        if (merger->add(std::move(post))) pending_redraw = true;
+    };
+    auto maybe_redraw = [&](bool force) {
+        if (!pending_redraw || !on_update) return;
+        auto now = clock_type::now();
+        if (!force && now - last_redraw < redraw_every) return;
+        last_redraw = now;
+        pending_redraw = false;
+        on_update();
+    };
+
+    std::vector<std::unique_ptr<PostStreamParser>> parsers;
+    std::vector<FanoutRequest> requests;
+    std::vector<long> hedge_after;
+    for (const auto &[score, address, server] : ranked) {
+        Window *window = &windows[parsers.size()];
+        parsers.push_back(std::make_unique<PostStreamParser>(
+            [&, window](std::string post) { on_post(*window, std::move(post)); }));
+        PostStreamParser *parser = parsers.back().get();
+
+        FanoutRequest req{.url = "http://" + server + "/get_posts"};
+        req.on_chunk = [&, parser](int status, std::string_view chunk) {
+            if (status != 200) return;      // error page, not a feed
+            parser->feed(chunk);
+            maybe_redraw(false);
+        };
+        requests.push_back(std::move(req));
+        hedge_after.push_back(health.hedge_after_ms(server));
+    }
 
-    for (const auto &server : servers) {
-        std::string url = "http://" + server + "/get_posts";
-        std::cerr << "[INFO] Fetching posts from: " << url << "\n";
+    // Pioneers only have what reached them, but every published post is on
+    // a write quorum, and any read_replicas() of them overlap it
+    size_t k = Config::read_replicas(requests.size());
+    std::vector<FanoutResult> results;
+    if (k >= requests.size()) {
+        std::cerr << "[INFO] Fetching from " << requests.size() << " pioneer(s)\n";
+        results = co_await fanout(requests);
+    } else {
+        std::cerr << "[INFO] Fetching from the " << k << " fastest of "
+                  << requests.size() << " pioneer(s)\n";
+        results = co_await fanout_first_k(requests, k, hedge_after);
+    }
 
-        auto [status, resp] = fetch_url_with_status(url);
+    bool any_success = false;
+    size_t received = 0;
+    std::vector<OnionAddress> answered;
+
+    for (auto &r : results) {
+        const std::string &url = requests[r.index].url;
+        PostStreamParser &parser = *parsers[r.index];
 
-        if (status != 200) {
-            std::cerr << "[WARN] " << url << " returned HTTP " << status << "\n";
+        if (!r.done) continue;      // cancelled, enough replicas answered
+        if (r.skipped) {
+            std::cerr << "[INFO] Skipping " << url << " (circuit open)\n";
             continue;
         }
-
-        if (resp.empty()) {
-            std::cerr << "[INFO] " << url << " has no posts yet\n";
+        if (r.code != CURLE_OK) continue;   // posts streamed so far are kept, the cut tail is not
+        if (r.status != 200) {
+            std::cerr << "[WARN] " << url << " returned HTTP " << r.status << "\n";
             continue;
         }
 
-        size_t pos = 0;
-        while ((pos = resp.find(delimiter)) != std::string::npos) {
-            std::string post = resp.substr(0, pos);
-
-            post.erase(post.begin(), std::find_if(post.begin(), post.end(),
-                [](unsigned char ch){ return !std::isspace(ch); }));
-            post.erase(std::find_if(post.rbegin(), post.rend(),
-                [](unsigned char ch){ return !std::isspace(ch); }).base(), post.end());
-
-            if (!post.empty()) {
-                posts_cache.push_back(post);
+        answered.push_back(*ranked[r.index].address);
+        parser.finish();
+        Window &w = windows[r.index];
+        if (!w.reached) {
+            std::lock_guard<std::mutex> lk(posts_mutex);
+            for (auto &post : w.held) {
+                if (merger->add(std::move(post))) pending_redraw = true;
             }
-
-            resp.erase(0, pos + delimiter.size());
+            w.held.clear();
         }
-
-        resp.erase(resp.begin(), std::find_if(resp.begin(), resp.end(),
-            [](unsigned char ch){ return !std::isspace(ch); }));
-        resp.erase(std::find_if(resp.rbegin(), resp.rend(),
-            [](unsigned char ch){ return !std::isspace(ch); }).base(), resp.end());
-        if (!resp.empty()) posts_cache.push_back(resp);
-
+        if (parser.emitted() == 0) {
+            std::cerr << "[INFO] " << url << " has no posts yet\n";
+        }
+        received += parser.emitted();
         any_success = true;
     }
+    maybe_redraw(true);
 
-    std::cerr << "[INFO] Total posts fetched: " << posts_cache.size() << "\n";
-    return any_success;
-}
+    // Only the posts that are new since the last refresh hit the disk
+    append_feed_cache();
+    if (pioneers.refresh_health(answered)) pioneers.save();
 
-bool send_post_to_all(const std::string &post) {
-    std::vector<std::string> servers;
+    size_t total;
     {
-        std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-        servers = pioneers;
+        std::lock_guard<std::mutex> lk(posts_mutex);
+        total = posts_cache.size();
     }
+    std::cerr << "[INFO] Total posts: " << total << " (" << total - before << " new, "
+              << received << " received)\n";
+    co_return any_success;
+}
 
-    if (servers.empty()) {
-        std::cerr << "[ERROR] No pioneers available for posting\n";
-        return false;
+Task<bool> fetch_posts_async(std::function<void()> on_update) {
+    struct Refresh {
+        AsyncEvent done;
+        bool ok = false;
+    };
+    static std::mutex refresh_mutex;
+    static std::shared_ptr<Refresh> running;
+
+    std::shared_ptr<Refresh> refresh;
+    bool joined;
+    {
+        std::lock_guard<std::mutex> lk(refresh_mutex);
+        joined = running != nullptr;
+        if (!joined) running = std::make_shared<Refresh>();
+        refresh = running;
+    }
+    if (joined) {
+        co_await refresh->done.wait(Executor::instance().token());
+        std::lock_guard<std::mutex> lk(refresh_mutex);
+        co_return refresh->ok;
     }
 
-    bool any_ok = false;
+    bool ok = co_await fetch_posts(std::move(on_update));
+    {
+        std::lock_guard<std::mutex> lk(refresh_mutex);
+        refresh->ok = ok;
+        running.reset();
+    }
+    refresh->done.set();
+    co_return ok;
+}
 
-    for (const auto &server : servers) {
-        CURL *curl = curl_easy_init();
-        if (!curl) continue;
+Task<PublishResult> send_post_to_all(std::string post) {
+    size_t servers = pioneers.size();
 
-        std::string url = "http://" + server + "/add_post";
-        std::cerr << "[INFO] Posting to: " << url << "\n";
+    // On disk before anything goes on the wire
+    Outbox &outbox = Outbox::instance();
+    uint64_t id = outbox.enqueue(post);
+    if (id == 0) co_return PublishResult::FAILED;
 
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_POST, 1L);
-        curl_easy_setopt(curl, CURLOPT_POSTFIELDS, post.c_str());
-        curl_easy_setopt(curl, CURLOPT_PROXY, "socks5h://127.0.0.1:9050");
-        curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+    if (servers == 0) {
+        std::cerr << "[WARN] No pioneers available, post kept in the outbox\n";
+        co_return PublishResult::QUEUED;
+    }
 
-        CURLcode res = curl_easy_perform(curl);
-        if (res == CURLE_OK) {
-            long http_code = 0;
-            curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
-            if (http_code == 201 || http_code == 200) {
-                std::cerr << "[OK] Post published to " << server << "\n";
-                any_ok = true;
-            } else {
-                std::cerr << "[WARN] " << server << " returned HTTP " << http_code << "\n";
-            }
-        } else {
-            std::cerr << "[ERROR] Failed to connect to " << server << ": "
-                      << curl_easy_strerror(res) << "\n";
-        }
+    size_t quorum = Config::write_quorum(servers);
+    std::cerr << "[INFO] Posting to " << servers << " pioneer(s), quorum " << quorum << "\n";
 
-        curl_easy_cleanup(curl);
+    size_t acks = co_await outbox.wait_acks(id, quorum, std::chrono::seconds(Config::PUBLISH_WAIT_S));
+    if (acks >= quorum) {
+        std::cerr << "[OK] Quorum reached (" << acks << "/" << servers << ")\n";
+        co_return PublishResult::PUBLISHED;
     }
+    co_return PublishResult::QUEUED;
+}
 
-    return any_ok;
+void wait_background_writes() {
+    Outbox::instance().stop();
 }
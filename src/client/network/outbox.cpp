@@ -0,0 +1,445 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/network/outbox.hpp"
+#include "client/network/fanout.hpp"
+#include "client/config.hpp"
+#include "client/feed/feed.hpp"
+#include "client/pionniers/pionniers.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace fs = std::filesystem;
+
+std::string encode_post_batch(const std::vector<std::string_view>& posts) {
+    size_t total = 0;
+    for (auto post : posts) total += post.size() + 24;
+
+    std::string body;
+    body.reserve(total);
+    for (auto post : posts) {
+        body += std::to_string(post.size());
+        body += '\n';
+        body += post;
+        body += '\n';
+    }
+    return body;
+}
+
+std::vector<bool> parse_post_batch_results(std::string_view body, size_t count) {
+    std::vector<bool> stored(count, false);
+
+    // First line is the "accepted N of M" summary
+    size_t nl = body.find('\n');
+    body.remove_prefix(nl == std::string_view::npos ? body.size() : nl + 1);
+
+    while (!body.empty()) {
+        nl = body.find('\n');
+        std::string_view line = body.substr(0, nl);
+        body.remove_prefix(nl == std::string_view::npos ? body.size() : nl + 1);
+
+        size_t sp = line.find(' ');
+        if (sp == std::string_view::npos || line.substr(sp + 1) != "ok") continue;
+
+        size_t index = 0;
+        bool digits = sp > 0;
+        for (char c : line.substr(0, sp)) {
+            if (c < '0' || c > '9') digits = false;
+            else index = index * 10 + static_cast<size_t>(c - '0');
+        }
+        if (digits && index < count) stored[index] = true;
+    }
+    return stored;
+}
+
+Outbox& Outbox::instance() {
+    static Outbox outbox;
+    return outbox;
+}
+
+Outbox::~Outbox() {
+    stop();
+}
+
+void Outbox::start() {
+    Executor& executor = Executor::instance();
+    CancellationToken token;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (running_) return;
+        ensure_loaded_locked();
+        stopping_ = false;
+        running_ = true;
+        if (!entries_.empty()) {
+            std::cerr << "[INFO] Outbox: " << entries_.size() << " post(s) waiting for delivery\n";
+        }
+        // Executor shutdown stops it as well
+        stop_source_ = std::make_unique<CancellationSource>(executor.token());
+        token = stop_source_->token();
+    }
+    executor.spawn(run(token));
+}
+
+void Outbox::stop() {
+    std::unique_lock<std::mutex> lk(mtx_);
+    stopping_ = true;
+    notify_acks_locked();
+    if (stop_source_) stop_source_->cancel();
+    stopped_cv_.wait(lk, [&] { return !running_; });
+}
+
+uint64_t Outbox::enqueue(const std::string& post) {
+    if (post.size() > PostStreamParser::MAX_POST_SIZE) {
+        std::cerr << "[ERROR] Post is too large to publish\n";
+        return 0;
+    }
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    ensure_loaded_locked();
+
+    uint64_t id = next_id_++;
+    std::string record = "post " + std::to_string(id) + " " + std::to_string(post.size()) + "\n";
+    record += post;
+    record += "\n";
+    // On the disk before the delivery task can send it
+    if (!append_locked(record, true)) {
+        std::cerr << "[ERROR] Could not save the post to the outbox\n";
+        return 0;
+    }
+
+    entries_[id].text = post;
+    wake_.set();
+    return id;
+}
+
+Task<size_t> Outbox::wait_acks(uint64_t id, size_t acks, std::chrono::milliseconds timeout) {
+    auto done_event = std::make_shared<AsyncEvent>();
+    bool ready;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        ready = acked_locked(id, acks);
+        if (!ready) ack_waiters_.push_back({id, acks, done_event});
+    }
+    if (!ready) co_await done_event->wait_for(timeout);
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    ack_waiters_.erase(std::remove_if(ack_waiters_.begin(), ack_waiters_.end(),
+        [&](const AckWaiter& w) { return w.done == done_event; }), ack_waiters_.end());
+
+    auto done = finished_.find(id);
+    if (done != finished_.end()) {
+        size_t n = done->second;
+        finished_.erase(done);
+        co_return n;
+    }
+    auto it = entries_.find(id);
+    co_return it == entries_.end() ? 0 : it->second.delivered.size();
+}
+
+bool Outbox::acked_locked(uint64_t id, size_t acks) const {
+    if (stopping_ || finished_.count(id)) return true;
+    auto it = entries_.find(id);
+    return it == entries_.end() || it->second.delivered.size() >= acks;
+}
+
+void Outbox::notify_acks_locked() {
+    for (const auto& w : ack_waiters_) {
+        if (acked_locked(w.id, w.acks)) w.done->set();
+    }
+}
+
+size_t Outbox::pending() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    ensure_loaded_locked();
+    return entries_.size();
+}
+
+Task<> Outbox::run(CancellationToken stop) {
+    while (!stop.cancelled()) {
+        wake_.reset();
+        bool sent = co_await deliver_round(stop);
+        if (stop.cancelled()) break;
+
+        // Wait until a backoff ends, a new post comes in, or we stop
+        auto now = clock_type::now();
+        auto wake = now + IDLE_RECHECK;
+        {
+            std::lock_guard<std::mutex> lk(mtx_);
+            if (sent && !entries_.empty()) continue;
+            if (!entries_.empty()) {
+                for (const auto& [host, b] : backoff_) {
+                    if (b.next_try > now && b.next_try < wake) wake = b.next_try;
+                }
+            }
+        }
+        co_await wake_.wait_for(wake - now, stop);
+    }
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    running_ = false;
+    stopped_cv_.notify_all();
+}
+
+Task<bool> Outbox::deliver_round(CancellationToken stop) {
+    std::vector<std::string> servers = pioneers.snapshot()->addresses();
+
+    // One request per job: a batch for a pioneer, or a single post
+    struct Job {
+        std::vector<uint64_t> ids;
+        std::string pioneer;
+        bool batch = false;
+    };
+    std::vector<Job> jobs;
+    std::vector<FanoutRequest> requests;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        auto now = clock_type::now();
+        for (const auto& server : servers) {
+            if (now < backoff_[server].next_try) continue;
+
+            std::vector<uint64_t> ids;
+            std::vector<std::string_view> texts;
+            size_t bytes = 0;
+            for (const auto& [id, entry] : entries_) {
+                if (entry.delivered.count(server)) continue;
+                if (ids.size() == BATCH_LIMIT) break;
+                if (!ids.empty() && bytes + entry.text.size() > BATCH_MAX_BYTES) break;
+                ids.push_back(id);
+                texts.push_back(entry.text);
+                bytes += entry.text.size();
+            }
+            if (ids.empty()) continue;
+
+            if (ids.size() > 1 && !no_batch_.count(server)) {
+                requests.push_back({.url = "http://" + server + "/add_posts", .post_body = encode_post_batch(texts)});
+                jobs.push_back({std::move(ids), server, true});
+            } else {
+                for (size_t i = 0; i < ids.size(); ++i) {
+                    requests.push_back({.url = "http://" + server + "/add_post", .post_body = std::string(texts[i])});
+                    jobs.push_back({{ids[i]}, server, false});
+                }
+            }
+        }
+    }
+    if (jobs.empty()) co_return false;
+
+    std::cerr << "[INFO] Outbox: " << requests.size() << " request(s) to send\n";
+
+    std::set<std::string> host_ok;
+    std::set<std::string> host_failed;
+    co_await fanout(requests, [&](const FanoutResult& r) {
+        const Job& job = jobs[r.index];
+        bool answered = r.code == CURLE_OK;
+
+        std::vector<bool> stored(job.ids.size(), false);
+        if (answered && job.batch && r.status == 404) {
+            // Older pioneer, next round sends the posts one by one
+            std::cerr << "[INFO] " << job.pioneer << " has no /add_posts, sending posts singly\n";
+        } else if (answered && job.batch && r.status == 200) {
+            stored = parse_post_batch_results(r.body, job.ids.size());
+        } else if (answered && !job.batch && (r.status == 201 || r.status == 200)) {
+            stored[0] = true;
+        }
+        size_t stored_count = std::count(stored.begin(), stored.end(), true);
+
+        if (r.skipped) {
+            // Circuit open, counts as a failed attempt without a request
+        } else if (!answered) {
+            std::cerr << "[ERROR] Failed to connect to " << job.pioneer << ": "
+                      << curl_easy_strerror(r.code) << "\n";
+        } else if (stored_count > 0) {
+            std::cerr << "[OK] " << stored_count << " post(s) published to " << job.pioneer << "\n";
+        } else if (r.status != 404) {
+            std::cerr << "[WARN] " << job.pioneer << " returned HTTP " << r.status << "\n";
+        }
+
+        std::lock_guard<std::mutex> lk(mtx_);
+        if (answered && job.batch && r.status == 404) {
+            no_batch_.insert(job.pioneer);
+            return !stopping_;
+        }
+
+        if (stored_count > 0) {
+            host_ok.insert(job.pioneer);
+        } else {
+            host_failed.insert(job.pioneer);
+        }
+        for (size_t i = 0; i < job.ids.size(); ++i) {
+            auto it = entries_.find(job.ids[i]);
+            if (it == entries_.end()) continue;
+            if (!stored[i]) {
+                it->second.failures[job.pioneer]++;
+            } else if (it->second.delivered.insert(job.pioneer).second) {
+                append_locked("sent " + std::to_string(job.ids[i]) + " " + job.pioneer + "\n");
+            }
+        }
+        notify_acks_locked();
+        return !stopping_;
+    }, Config::FANOUT_CONCURRENCY, stop);
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    for (const auto& host : host_failed) {
+        if (!host_ok.count(host)) schedule_retry_locked(host);
+    }
+    for (const auto& host : host_ok) backoff_[host] = HostBackoff{};
+
+    // Done: every pioneer has it, or a write quorum has it and the rest
+    // gave up. Below the quorum a read could miss it, so it keeps going.
+    const size_t quorum = Config::write_quorum(servers.size());
+    std::vector<std::pair<uint64_t, size_t>> done;
+    for (const auto& [id, entry] : entries_) {
+        size_t acks = entry.delivered.size();
+        if (acks == 0) continue;
+
+        bool complete = std::all_of(servers.begin(), servers.end(), [&](const std::string& s) {
+            if (entry.delivered.count(s)) return true;
+            auto f = entry.failures.find(s);
+            return f != entry.failures.end() && f->second > Config::PUBLISH_RETRIES;
+        });
+        if (complete && acks >= quorum) done.emplace_back(id, acks);
+    }
+    for (const auto& [id, acks] : done) finish_locked(id, acks);
+
+    if (entries_.empty()) rewrite_locked();
+    notify_acks_locked();
+    co_return true;
+}
+
+void Outbox::finish_locked(uint64_t id, size_t acks) {
+    append_locked("done " + std::to_string(id) + "\n");
+    entries_.erase(id);
+
+    // Nobody asks for posts from an earlier run or whose wait timed out,
+    // so only the newest results are kept
+    finished_[id] = acks;
+    while (finished_.size() > FINISHED_KEPT) finished_.erase(finished_.begin());
+}
+
+void Outbox::schedule_retry_locked(const std::string& pioneer) {
+    HostBackoff& b = backoff_[pioneer];
+    b.failures++;
+
+    // base * 2^(failures-1), capped, then spread by +-50% so retries of
+    // many clients do not line up
+    auto delay = std::chrono::seconds(Config::PUBLISH_RETRY_DELAY_S);
+    for (int i = 1; i < b.failures && delay < MAX_BACKOFF; ++i) delay *= 2;
+    delay = std::min<std::chrono::seconds>(delay, MAX_BACKOFF);
+
+    std::uniform_real_distribution<double> jitter(0.5, 1.5);
+    auto wait = std::chrono::duration_cast<clock_type::duration>(delay * jitter(rng_));
+    b.next_try = clock_type::now() + wait;
+
+    std::cerr << "[INFO] Outbox: retrying " << pioneer << " in "
+              << std::chrono::duration_cast<std::chrono::seconds>(wait).count() << "s\n";
+}
+
+void Outbox::ensure_loaded_locked() {
+    if (loaded_) return;
+    loaded_ = true;
+
+    std::string data;
+    try {
+        std::ifstream in(Config::OUTBOX_FILE, std::ios::binary);
+        if (!in) return;
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    } catch (...) {
+        return;
+    }
+
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t eol = data.find('\n', pos);
+        if (eol == std::string::npos) break;            // torn last line
+        std::istringstream line(data.substr(pos, eol - pos));
+        pos = eol + 1;
+
+        std::string tag;
+        uint64_t id = 0;
+        line >> tag >> id;
+        if (!line) break;
+        next_id_ = std::max(next_id_, id + 1);
+
+        if (tag == "post") {
+            size_t len = 0;
+            if (!(line >> len) || data.size() - pos < len + 1) break;
+            entries_[id].text = data.substr(pos, len);
+            pos += len + 1;
+        } else if (tag == "sent") {
+            std::string pioneer;
+            line >> pioneer;
+            auto it = entries_.find(id);
+            if (it != entries_.end() && !pioneer.empty()) it->second.delivered.insert(pioneer);
+        } else if (tag == "done") {
+            entries_.erase(id);
+        } else {
+            break;
+        }
+    }
+
+    // Drop finished posts and any torn tail
+    rewrite_locked();
+}
+
+bool Outbox::append_locked(const std::string& record, bool sync) {
+    if (!journal_.is_open()) {
+        std::error_code ec;
+        fs::create_directories(fs::path(Config::OUTBOX_FILE).parent_path(), ec);
+        if (!journal_.open(Config::OUTBOX_FILE)) return false;
+    }
+    if (!journal_.append(record) || (sync && !journal_.sync())) {
+        // Reopened on the next append
+        journal_.close();
+        return false;
+    }
+    return true;
+}
+
+bool Outbox::rewrite_locked() {
+    journal_.close();
+
+    std::error_code ec;
+    if (entries_.empty()) {
+        fs::remove(Config::OUTBOX_FILE, ec);
+        return !ec;
+    }
+
+    std::string data;
+    for (const auto& [id, entry] : entries_) {
+        data += "post " + std::to_string(id) + " " + std::to_string(entry.text.size()) + "\n";
+        data += entry.text;
+        data += "\n";
+        for (const auto& pioneer : entry.delivered) {
+            data += "sent " + std::to_string(id) + " " + pioneer + "\n";
+        }
+    }
+
+    const fs::path path = Config::OUTBOX_FILE;
+    const fs::path tmp = Config::OUTBOX_FILE + ".tmp";
+    fs::create_directories(path.parent_path(), ec);
+    if (!sync_io::write_file(tmp, data)) return false;
+
+    fs::rename(tmp, path, ec);
+    if (ec) return false;
+    if (!sync_io::sync_dir(path.parent_path())) {
+        std::cerr << "[WARN] Outbox: could not sync " << path.parent_path().string() << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/pionniers/directory.hpp"
+#include "client/pionniers/node_store.hpp"
+#include "client/network/host_health.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <unordered_set>
+
+const PioneerInfo* PioneerSnapshot::find(const OnionAddress& address) const {
+    auto it = index.find(address);
+    return it == index.end() ? nullptr : &list[it->second];
+}
+
+std::vector<std::string> PioneerSnapshot::addresses() const {
+    std::vector<std::string> out;
+    out.reserve(list.size());
+    for (const auto& p : list) out.push_back(p.address.to_string());
+    return out;
+}
+
+PioneerDirectory::PioneerDirectory()
+    : current_(std::make_shared<const PioneerSnapshot>()) {}
+
+std::shared_ptr<const PioneerSnapshot> PioneerDirectory::snapshot() const {
+    return current_.load();
+}
+
+void PioneerDirectory::publish(std::shared_ptr<PioneerSnapshot> next) {
+    next->version = snapshot()->version + 1;
+    current_.store(std::move(next));
+}
+
+bool PioneerDirectory::merge(const std::vector<OnionAddress>& added,
+                             const std::vector<OnionAddress>& removed,
+                             const std::string& source) {
+    std::lock_guard<std::mutex> lk(write_mtx_);
+    auto next = std::make_shared<PioneerSnapshot>(*snapshot());
+    bool changed = false;
+
+    if (!removed.empty()) {
+        std::unordered_set<size_t> drop;
+        for (const auto& address : removed) {
+            auto it = next->index.find(address);
+            if (it != next->index.end()) drop.insert(it->second);
+        }
+
+        if (!drop.empty()) {
+            changed = true;
+            std::vector<PioneerInfo> kept;
+            kept.reserve(next->list.size() - drop.size());
+            for (size_t i = 0; i < next->list.size(); ++i) {
+                if (!drop.count(i)) kept.push_back(std::move(next->list[i]));
+            }
+            next->list = std::move(kept);
+            next->index.clear();
+            for (size_t i = 0; i < next->list.size(); ++i) {
+                next->index.emplace(next->list[i].address, i);
+            }
+        }
+    }
+
+    for (const auto& address : added) {
+        if (next->index.emplace(address, next->list.size()).second) {
+            next->list.push_back({address});
+            changed = true;
+        }
+    }
+
+    if (!source.empty() && next->source != source) {
+        next->source = source;
+        changed = true;
+    }
+    if (changed) publish(std::move(next));
+    return changed;
+}
+
+bool PioneerDirectory::apply_gate_syncs(const std::vector<GateSync>& syncs, uint64_t live,
+                                        const std::string& source) {
+    std::lock_guard<std::mutex> lk(write_mtx_);
+    auto next = std::make_shared<PioneerSnapshot>(*snapshot());
+    bool changed = false;
+
+    for (auto& p : next->list) {
+        if (p.gates & ~live) {
+            p.gates &= live;
+            changed = true;
+        }
+    }
+
+    std::unordered_set<OnionAddress> announced;
+    std::unordered_set<OnionAddress> dropped;
+    for (const auto& sync : syncs) {
+        // A federated gate's view is the network's, its removals clear every gate
+        const uint64_t clear = sync.federated ? ~uint64_t(0) : sync.bit;
+        announced.insert(sync.added.begin(), sync.added.end());
+
+        if (sync.full) {
+            std::unordered_set<OnionAddress> listed(sync.added.begin(), sync.added.end());
+            for (auto& p : next->list) {
+                if (!(p.gates & clear) || listed.count(p.address)) continue;
+                p.gates &= ~clear;
+                dropped.insert(p.address);
+                changed = true;
+            }
+        }
+        for (const auto& address : sync.removed) {
+            auto it = next->index.find(address);
+            if (it == next->index.end()) continue;
+            next->list[it->second].gates &= ~clear;
+            dropped.insert(address);
+            changed = true;
+        }
+        for (const auto& address : sync.added) {
+            auto [it, inserted] = next->index.emplace(address, next->list.size());
+            if (inserted) next->list.push_back({address});
+            PioneerInfo& p = next->list[it->second];
+            if (inserted || (p.gates & sync.bit) != sync.bit) changed = true;
+            p.gates |= sync.bit;
+        }
+    }
+
+    // Still listed somewhere, stays
+    for (auto it = dropped.begin(); it != dropped.end();) {
+        if (announced.count(*it) || next->find(*it)->gates != 0) it = dropped.erase(it);
+        else ++it;
+    }
+    if (!dropped.empty()) {
+        std::vector<PioneerInfo> kept;
+        kept.reserve(next->list.size() - dropped.size());
+        for (auto& p : next->list) {
+            if (!dropped.count(p.address)) kept.push_back(std::move(p));
+        }
+        next->list = std::move(kept);
+        next->index.clear();
+        for (size_t i = 0; i < next->list.size(); ++i) {
+            next->index.emplace(next->list[i].address, i);
+        }
+    }
+
+    if (!source.empty() && next->source != source) {
+        next->source = source;
+        changed = true;
+    }
+    if (changed) publish(std::move(next));
+    return changed;
+}
+
+void PioneerDirectory::reset(const std::vector<std::string>& list, const std::string& source) {
+    std::vector<PioneerInfo> infos;
+    infos.reserve(list.size());
+    for (const auto& address : list) {
+        if (auto onion = OnionAddress::parse(address)) infos.push_back({*onion});
+    }
+    reset(infos, source);
+}
+
+void PioneerDirectory::reset(const std::vector<PioneerInfo>& list, const std::string& source) {
+    std::lock_guard<std::mutex> lk(write_mtx_);
+    auto next = std::make_shared<PioneerSnapshot>();
+    next->source = source;
+    next->list.reserve(list.size());
+    for (const auto& info : list) {
+        if (next->index.emplace(info.address, next->list.size()).second) {
+            next->list.push_back(info);
+        }
+    }
+    publish(std::move(next));
+}
+
+bool PioneerDirectory::refresh_health(const std::vector<OnionAddress>& answered) {
+    HostHealth& health = HostHealth::instance();
+    int64_t now = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    std::lock_guard<std::mutex> lk(write_mtx_);
+    auto current = snapshot();
+
+    // Compared against the current snapshot first, a refresh that only
+    // confirms what is known costs no copy and no disk write
+    std::vector<double> scores(current->list.size());
+    bool changed = false;
+    for (size_t i = 0; i < scores.size(); ++i) {
+        scores[i] = health.score(current->list[i].address.to_string());
+        if (scores[i] != current->list[i].score) changed = true;
+    }
+    std::vector<size_t> seen;
+    for (const auto& address : answered) {
+        auto it = current->index.find(address);
+        if (it == current->index.end()) continue;
+        if (now - current->list[it->second].last_seen >= LAST_SEEN_STEP_S) seen.push_back(it->second);
+    }
+    if (!changed && seen.empty()) return false;
+
+    auto next = std::make_shared<PioneerSnapshot>(*current);
+    for (size_t i = 0; i < scores.size(); ++i) next->list[i].score = scores[i];
+    for (size_t i : seen) next->list[i].last_seen = now;
+    publish(std::move(next));
+    return true;
+}
+
+bool PioneerDirectory::save() {
+    auto snap = snapshot();
+
+    std::lock_guard<std::mutex> lk(save_mtx_);
+    if (snap->version != 0 && snap->version <= saved_version_) return true;
+
+    if (!NodeStore::instance().commit_pioneers(snap->list)) {
+        std::cerr << "[ERROR] Failed to save pioneers\n";
+        return false;
+    }
+
+    saved_version_ = snap->version;
+    return true;
+}
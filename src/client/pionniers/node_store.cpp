@@ -0,0 +1,383 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/pionniers/node_store.hpp"
+#include "client/config.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string_view>
+
+#include "utils/filesys/sync_io.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char MAGIC[8] = {'T', 'S', 'P', 'N', 'O', 'D', 'E', '1'};
+const uint8_t FLAG_REMOVED = 1;
+
+uint32_t crc32(const char* data, size_t len) {
+    static const auto table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    uint32_t c = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; ++i) {
+        c = table[(c ^ static_cast<unsigned char>(data[i])) & 0xff] ^ (c >> 8);
+    }
+    return c ^ 0xFFFFFFFFu;
+}
+
+void put_le(char* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = static_cast<char>((v >> (8 * i)) & 0xff);
+}
+
+uint64_t get_le(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= static_cast<uint64_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+    return v;
+}
+
+uint64_t double_bits(double d) {
+    uint64_t v;
+    std::memcpy(&v, &d, sizeof(v));
+    return v;
+}
+
+double bits_double(uint64_t v) {
+    double d;
+    std::memcpy(&d, &v, sizeof(d));
+    return d;
+}
+
+struct Header {
+    uint64_t generation = 0;
+    uint64_t record_count = 0;
+};
+
+void encode_header(char* out, const Header& h) {
+    std::memset(out, 0, NodeStore::HEADER_SIZE);
+    std::memcpy(out, MAGIC, sizeof(MAGIC));
+    put_le(out + 8, NodeStore::FORMAT, 4);
+    put_le(out + 12, NodeStore::RECORD_SIZE, 4);
+    put_le(out + 16, h.generation, 8);
+    put_le(out + 24, h.record_count, 8);
+    put_le(out + 32, crc32(out, 32), 4);
+}
+
+bool decode_header(const char* in, Header& h) {
+    if (std::memcmp(in, MAGIC, sizeof(MAGIC)) != 0) return false;
+    if (get_le(in + 8, 4) != NodeStore::FORMAT) return false;
+    if (get_le(in + 12, 4) != NodeStore::RECORD_SIZE) return false;
+    if (get_le(in + 32, 4) != crc32(in, 32)) return false;
+    h.generation = get_le(in + 16, 8);
+    h.record_count = get_le(in + 24, 8);
+    return true;
+}
+
+void encode_record(char* out, uint8_t kind, uint8_t flags, const std::string& address,
+                   const std::array<uint64_t, 3>& field) {
+    std::memset(out, 0, NodeStore::RECORD_SIZE);
+    out[4] = static_cast<char>(kind);
+    out[5] = static_cast<char>(flags);
+    put_le(out + 6, address.size(), 2);
+    for (size_t i = 0; i < field.size(); ++i) put_le(out + 8 + 8 * i, field[i], 8);
+    std::memcpy(out + 32, address.data(), address.size());
+    put_le(out, crc32(out + 4, NodeStore::RECORD_SIZE - 4), 4);
+}
+
+std::array<uint64_t, 3> pioneer_fields(const PioneerInfo& info) {
+    return {double_bits(info.score), static_cast<uint64_t>(info.last_seen), info.gates};
+}
+
+std::array<uint64_t, 3> gate_fields(const GateCursor& cursor) {
+    return {cursor.epoch, cursor.version, static_cast<uint64_t>(cursor.slot + 1)};
+}
+
+} // namespace
+
+NodeStore& NodeStore::instance() {
+    static NodeStore store;
+    return store;
+}
+
+bool NodeStore::load(std::vector<std::string>& gates, std::vector<PioneerInfo>& pioneers) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    if (!load_locked()) return false;
+
+    std::vector<std::pair<size_t, const Image::value_type*>> ordered;
+    ordered.reserve(nodes_.size());
+    for (const auto& entry : nodes_) ordered.emplace_back(entry.second.order, &entry);
+    std::sort(ordered.begin(), ordered.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    for (const auto& [order, entry] : ordered) {
+        const auto& [key, node] = *entry;
+        if (key.first == GATE) {
+            gates.push_back(key.second);
+        } else if (key.first == PIONEER) {
+            auto onion = OnionAddress::parse(key.second);
+            if (!onion) continue;
+            pioneers.push_back({*onion, bits_double(node.field[0]),
+                                static_cast<int64_t>(node.field[1]), node.field[2]});
+        }
+    }
+    return true;
+}
+
+bool NodeStore::load_locked() {
+    if (loaded_) return present_;
+    loaded_ = true;
+
+    std::string data;
+    try {
+        std::ifstream in(Config::NODES_FILE, std::ios::binary);
+        if (!in) return false;
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    } catch (...) {
+        return false;
+    }
+    if (data.size() < 2 * HEADER_SIZE) return false;
+
+    // The newest header whose records are all there
+    Header best;
+    bool found = false;
+    for (int slot = 0; slot < 2; ++slot) {
+        Header h;
+        if (!decode_header(data.data() + slot * HEADER_SIZE, h)) continue;
+        if (2 * HEADER_SIZE + h.record_count * RECORD_SIZE > data.size()) continue;
+        if (!found || h.generation > best.generation) {
+            best = h;
+            active_slot_ = slot;
+            found = true;
+        }
+    }
+    if (!found) {
+        std::cerr << "[WARN] Node store has no valid header, ignoring it\n";
+        return false;
+    }
+
+    present_ = true;
+    file_ok_ = true;
+    const char* rec = data.data() + 2 * HEADER_SIZE;
+    uint64_t count = 0;
+    for (; count < best.record_count; ++count, rec += RECORD_SIZE) {
+        if (get_le(rec, 4) != crc32(rec + 4, RECORD_SIZE - 4)) {
+            std::cerr << "[WARN] Node store record " << count << " is damaged\n";
+            file_ok_ = false;   // keep what we have, next commit writes a clean file
+            break;
+        }
+
+        uint8_t kind = static_cast<uint8_t>(rec[4]);
+        uint8_t flags = static_cast<uint8_t>(rec[5]);
+        size_t len = std::min<size_t>(get_le(rec + 6, 2), MAX_ADDRESS);
+        Key key{kind, std::string(rec + 32, len)};
+
+        if (flags & FLAG_REMOVED) {
+            nodes_.erase(key);
+            continue;
+        }
+        auto [it, inserted] = nodes_.try_emplace(key);
+        if (inserted) it->second.order = static_cast<size_t>(count);
+        for (size_t i = 0; i < it->second.field.size(); ++i) it->second.field[i] = get_le(rec + 8 + 8 * i, 8);
+    }
+
+    generation_ = best.generation;
+    record_count_ = count;
+    return true;
+}
+
+bool NodeStore::commit_gates(const std::vector<std::string>& gates) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    load_locked();
+
+    std::vector<std::pair<std::string, Fields>> nodes;
+    nodes.reserve(gates.size());
+    for (const auto& g : gates) {
+        auto it = nodes_.find({GATE, g});
+        nodes.emplace_back(g, it != nodes_.end() ? it->second.field : gate_fields({}));
+    }
+    return commit_locked(GATE, nodes);
+}
+
+bool NodeStore::commit_pioneers(const std::vector<PioneerInfo>& pioneers) {
+    std::vector<std::pair<std::string, Fields>> nodes;
+    nodes.reserve(pioneers.size());
+    for (const auto& p : pioneers) nodes.emplace_back(p.address.to_string(), pioneer_fields(p));
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    load_locked();
+    return commit_locked(PIONEER, nodes);
+}
+
+std::map<std::string, GateCursor> NodeStore::gate_cursors() {
+    std::lock_guard<std::mutex> lk(mtx_);
+    load_locked();
+
+    std::map<std::string, GateCursor> out;
+    for (const auto& [key, node] : nodes_) {
+        if (key.first == GATE) {
+            out[key.second] = {node.field[0], node.field[1], static_cast<int>(node.field[2]) - 1};
+        }
+    }
+    return out;
+}
+
+bool NodeStore::commit_gate_cursors(const std::map<std::string, GateCursor>& cursors) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    load_locked();
+
+    // Same gates in the same order, only the cursors move
+    std::vector<std::pair<size_t, std::pair<std::string, Fields>>> ordered;
+    for (const auto& [key, node] : nodes_) {
+        if (key.first != GATE) continue;
+        auto it = cursors.find(key.second);
+        Fields field = it != cursors.end() ? gate_fields(it->second) : node.field;
+        ordered.push_back({node.order, {key.second, field}});
+    }
+    std::sort(ordered.begin(), ordered.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<std::pair<std::string, Fields>> nodes;
+    nodes.reserve(ordered.size());
+    for (auto& entry : ordered) nodes.push_back(std::move(entry.second));
+    return commit_locked(GATE, nodes);
+}
+
+bool NodeStore::commit_locked(Kind kind, const std::vector<std::pair<std::string, Fields>>& nodes) {
+    std::string records;
+    uint64_t next = record_count_;
+    Image image;        // committed state after this call
+
+    auto append = [&](const Key& key, uint8_t flags, const Node& node) {
+        char buf[RECORD_SIZE];
+        encode_record(buf, key.first, flags, key.second, node.field);
+        records.append(buf, RECORD_SIZE);
+        next++;
+    };
+
+    for (const auto& [address, field] : nodes) {
+        if (address.empty() || address.size() > MAX_ADDRESS) continue;
+        Key key{kind, address};
+        if (image.count(key)) continue;
+
+        Node node{field, static_cast<size_t>(next)};
+        auto it = nodes_.find(key);
+        if (it != nodes_.end()) {
+            node.order = it->second.order;
+            if (it->second.field == node.field) {
+                image.emplace(key, node);
+                continue;
+            }
+        }
+        append(key, 0, node);
+        image.emplace(key, node);
+    }
+    for (const auto& [key, node] : nodes_) {
+        if (key.first != kind) image.emplace(key, node);
+        else if (!image.count(key)) append(key, FLAG_REMOVED, node);
+    }
+
+    if (records.empty() && file_ok_) return true;
+
+    // Mostly superseded records, or nothing usable on disk: start over
+    if (!file_ok_ || next > 2 * image.size() + 64) return rewrite_locked(std::move(image));
+
+    // Each write is on the disk before the next one depends on it: the
+    // records before the header that names them
+    sync_io::File f;
+    std::error_code ec;
+    if (!fs::exists(Config::NODES_FILE, ec) || !f.open(Config::NODES_FILE)) {
+        return rewrite_locked(std::move(image));
+    }
+    if (!f.write_at(2 * HEADER_SIZE + record_count_ * RECORD_SIZE, records) || !f.sync()) {
+        std::cerr << "[ERROR] Node store commit failed: could not write records\n";
+        return false;
+    }
+
+    // The commit point: the other header slot now names the new records
+    char header[HEADER_SIZE];
+    encode_header(header, {generation_ + 1, next});
+    int slot = 1 - active_slot_;
+    if (!f.write_at(slot * HEADER_SIZE, std::string_view(header, HEADER_SIZE)) || !f.sync()) {
+        std::cerr << "[ERROR] Node store commit failed: could not write header\n";
+        return false;
+    }
+
+    nodes_ = std::move(image);
+    generation_++;
+    record_count_ = next;
+    active_slot_ = 1 - active_slot_;
+    return true;
+}
+
+bool NodeStore::rewrite_locked(Image image) {
+    std::vector<std::pair<size_t, Image::value_type*>> ordered;
+    ordered.reserve(image.size());
+    for (auto& entry : image) ordered.emplace_back(entry.second.order, &entry);
+    std::sort(ordered.begin(), ordered.end(),
+        [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::string data(2 * HEADER_SIZE, '\0');
+    encode_header(&data[0], {generation_ + 1, ordered.size()});
+    data.reserve(data.size() + ordered.size() * RECORD_SIZE);
+
+    size_t index = 0;
+    for (auto& [order, entry] : ordered) {
+        char buf[RECORD_SIZE];
+        encode_record(buf, entry->first.first, 0, entry->first.second, entry->second.field);
+        data.append(buf, RECORD_SIZE);
+        entry->second.order = index++;
+    }
+
+    // The new file is on the disk before it replaces the old one
+    const fs::path path = Config::NODES_FILE;
+    const fs::path tmp = Config::NODES_FILE + ".tmp";
+    std::error_code ec;
+    fs::create_directories(path.parent_path(), ec);
+    if (!sync_io::write_file(tmp, data)) {
+        std::cerr << "[ERROR] Node store rewrite failed: could not write " << tmp.string() << "\n";
+        return false;
+    }
+    fs::rename(tmp, path, ec);
+    if (ec) {
+        std::cerr << "[ERROR] Node store rewrite failed: " << ec.message() << "\n";
+        return false;
+    }
+    // The file is in place either way, only a crash could still undo it
+    if (!sync_io::sync_dir(path.parent_path())) {
+        std::cerr << "[WARN] Node store: could not sync the data directory\n";
+    }
+
+    nodes_ = std::move(image);
+    generation_++;
+    record_count_ = ordered.size();
+    active_slot_ = 0;
+    file_ok_ = true;
+    return true;
+}
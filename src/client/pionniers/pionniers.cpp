@@ -23,14 +23,16 @@
 #include <iostream>
 
 #include "client/pionniers/pionniers.hpp"
+#include "client/pionniers/node_store.hpp"
+#include "client/utils/gate_parser.hpp"
 #include "client/config.hpp"
 #include "client/network/network.hpp"
+#include "client/network/fanout.hpp"
+#include "utils/onion/onion_address.hpp"
 
 
 namespace fs = std::filesystem;
 
-std::recursive_mutex pioneers_mutex;
-
 bool ensure_data_dir(std::string data_dir)
 {
     try {
@@ -62,8 +64,8 @@ bool ensure_data_dir(std::string data_dir)
     }
 }
 
-std::vector<std::string> parse_lines(const std::string& input) {
-    std::vector<std::string> out;
+std::vector<OnionAddress> parse_lines(const std::string& input) {
+    std::vector<OnionAddress> out;
     std::stringstream ss(input);
     std::string line;
     while (std::getline(ss, line)) {
@@ -72,15 +74,15 @@ std::vector<std::string> parse_lines(const std::string& input) {
             [](unsigned char ch){ return !std::isspace(ch); }));
         line.erase(std::find_if(line.rbegin(), line.rend(),
             [](unsigned char ch){ return !std::isspace(ch); }).base(), line.end());
-        if (!line.empty() && line.find(".onion") != std::string::npos) {
-            out.push_back(line);
+        if (auto onion = OnionAddress::parse(line)) {
+            out.push_back(*onion);
         }
     }
     return out;
 }
 
-std::vector<std::string> parse_pioneers_from_string(const std::string& input) {
-    std::vector<std::string> out;
+std::vector<OnionAddress> parse_pioneers_from_string(const std::string& input) {
+    std::vector<OnionAddress> out;
     size_t a = input.find('[');
     size_t b = input.rfind(']');
     if (a == std::string::npos || b == std::string::npos || b <= a) return out;
@@ -97,37 +99,21 @@ std::vector<std::string> parse_pioneers_from_string(const std::string& input) {
             [](unsigned char ch){ return !std::isspace(ch); }));
         item.erase(std::find_if(item.rbegin(), item.rend(),
             [](unsigned char ch){ return !std::isspace(ch); }).base(), item.end());
-        if (!item.empty() && item.find(".onion") != std::string::npos) out.push_back(item);
+        if (auto onion = OnionAddress::parse(item)) out.push_back(*onion);
         pos = q2 + 1;
     }
     return out;
 }
 
 bool save_pioneers_file() {
-    std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-    ensure_data_dir(Config::PIONEERS_FILE);
-
-    try {
-        std::ofstream out(Config::PIONEERS_FILE, std::ios::trunc);
-        if (!out) return false;
-        out << "[\n";
-        for (size_t i = 0; i < pioneers.size(); ++i) {
-            out << "  \"" << pioneers[i] << "\"";
-            if (i + 1 < pioneers.size()) out << ",";
-            out << "\n";
-        }
-        out << "]\n";
-        out.close();
-        return true;
-    } catch (...) {
-        return false;
-    }
+    return pioneers.save();
 }
 
-std::vector<std::string> load_pioneers_file() {
-    std::vector<std::string> result;
-    std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-    ensure_data_dir(Config::PIONEERS_FILE);
+// Reads the node store. On the first start with it, takes over the old
+// pioneers.json and gates.txt instead and commits them to the store.
+static void load_node_store(std::vector<std::string>& gate_list, std::vector<PioneerInfo>& pioneer_list) {
+    if (NodeStore::instance().load(gate_list, pioneer_list)) return;
+
     try {
         std::ifstream in(Config::PIONEERS_FILE);
         std::string all((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
@@ -140,12 +126,47 @@ std::vector<std::string> load_pioneers_file() {
             if (q2 == std::string::npos) break;
             std::string s = all.substr(q1 + 1, q2 - q1 - 1);
             pos = q2 + 1;
-            if (s.find(".onion") != std::string::npos) result.push_back(s);
+            if (auto onion = OnionAddress::parse(s)) pioneer_list.push_back({*onion});
         }
     } catch (...) {}
+    gate_list = GatesParser::loadFromFile(Config::GATES_FILE);
+
+    if (!pioneer_list.empty()) NodeStore::instance().commit_pioneers(pioneer_list);
+    if (!gate_list.empty()) NodeStore::instance().commit_gates(gate_list);
+}
+
+std::vector<PioneerInfo> load_pioneers_file() {
+    std::vector<std::string> gate_list;
+    std::vector<PioneerInfo> result;
+    load_node_store(gate_list, result);
+    return result;
+}
+
+std::vector<std::string> load_gates_file() {
+    std::vector<std::string> result;
+    std::vector<PioneerInfo> pioneer_list;
+    load_node_store(result, pioneer_list);
     return result;
 }
 
+bool save_gates_file(const std::vector<std::string>& list) {
+    return NodeStore::instance().commit_gates(list);
+}
+
+std::map<std::string, GateCursor> load_gate_versions() {
+    return NodeStore::instance().gate_cursors();
+}
+
+bool save_gate_versions(const std::map<std::string, GateCursor>& cursors) {
+    return NodeStore::instance().commit_gate_cursors(cursors);
+}
+
+void reset_gate_versions() {
+    auto cursors = load_gate_versions();
+    for (auto& [gate, cur] : cursors) cur.epoch = cur.version = 0;
+    save_gate_versions(cursors);
+}
+
 void load_gates_from_argv(int argc, char* argv[]) {
     if (argc < 2) return;
     try {
@@ -159,35 +180,91 @@ void load_gates_from_argv(int argc, char* argv[]) {
         }
 
         if (!parsed.empty()) {
-            std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
-            for (auto &p : parsed) {
-                if (std::find(pioneers.begin(), pioneers.end(), p) == pioneers.end())
-                    pioneers.push_back(p);
-            }
-            pioneers_source = "argv";
+            pioneers.merge(parsed, {}, "argv");
             save_pioneers_file();
         }
     } catch (...) {}
 }
 
-bool update_pioneers_from_gates() {
-    auto new_pioneers = fetch_servers_from_gates();
+Task<bool> update_pioneers_from_gates() {
+    auto cursors = load_gate_versions();
 
-    if (new_pioneers.empty()) {
-        std::cerr << "[WARN] Gates did not return any pioneers\n";
-        return false;
+    // Every gate gets a membership slot, a new one starts from its full list
+    uint64_t live = 0;
+    for (const auto& gate : gates) {
+        auto it = cursors.find(gate);
+        if (it != cursors.end() && it->second.slot >= 0) live |= uint64_t(1) << it->second.slot;
+    }
+    for (const auto& gate : gates) {
+        GateCursor& cur = cursors[gate];
+        for (int slot = 0; cur.slot < 0 && slot < GATE_SLOTS; ++slot) {
+            if (live & (uint64_t(1) << slot)) continue;
+            cur = {0, 0, slot};
+            live |= uint64_t(1) << slot;
+        }
     }
 
-    std::lock_guard<std::recursive_mutex> lg(pioneers_mutex);
+    std::vector<GateSync> syncs;
+    bool any_ok = false;
+    size_t transferred = 0;
+
+    std::vector<FanoutRequest> requests;
+    for (const auto& gate : gates) {
+        const GateCursor& cur = cursors[gate];
+        requests.push_back({.url = pioneers_delta_url(gate, cur.epoch, cur.version)});
+    }
 
-    for (const auto& p : new_pioneers) {
-        if (std::find(pioneers.begin(), pioneers.end(), p) == pioneers.end()) {
-            pioneers.push_back(p);
+    auto take = [&](const std::string& gate, GateDelta& delta) {
+        any_ok = true;
+        transferred += delta.added.size() + delta.removed.size();
+        GateCursor& cur = cursors[gate];
+        GateSync sync;
+        sync.bit = cur.slot >= 0 ? uint64_t(1) << cur.slot : 0;
+        sync.full = delta.full;
+        sync.federated = delta.federated;
+        sync.added = std::move(delta.added);
+        sync.removed = std::move(delta.removed);
+        syncs.push_back(std::move(sync));
+        cur.epoch = delta.epoch;
+        cur.version = delta.version;
+    };
+
+    std::vector<std::string> legacy;
+    co_await fanout(requests, [&](const FanoutResult& r) {
+        const std::string& gate = gates[r.index];
+        if (r.status == 404) {
+            legacy.push_back(gate);
+            return true;
+        }
+        if (r.status != 200) return true;
+
+        GateDelta delta = parse_pioneers_delta(r.body);
+        if (!delta.ok) {
+            std::cerr << "[WARN] " << gate << " sent malformed delta header\n";
+            return true;
         }
+        bool federated = delta.federated;
+        take(gate, delta);
+
+        // A federated gate already knows what the other gates know
+        return !federated;
+    });
+
+    // Old gates without delta support, rare enough to ask one by one
+    for (const auto& gate : legacy) {
+        GateDelta delta = co_await fetch_legacy_pioneers(gate);
+        if (delta.ok) take(gate, delta);
     }
 
-    save_pioneers_file();
-    std::cerr << "[INFO] Updated pioneers list, now have "
+    if (!any_ok) {
+        std::cerr << "[WARN] Gates did not return any pioneers\n";
+        co_return false;
+    }
+
+    if (pioneers.apply_gate_syncs(syncs, live, transferred > 0 ? "gates" : "")) save_pioneers_file();
+
+    save_gate_versions(cursors);
+    std::cerr << "[INFO] Directory sync: " << transferred << " change(s), now have "
               << pioneers.size() << " pioneers\n";
-    return true;
+    co_return true;
 }
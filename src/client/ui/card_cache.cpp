@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/ui/card_cache.hpp"
+
+const PostCard& PostCardCache::get(const FeedPost& post, size_t index, int width) {
+    if (width != width_) {
+        clear();
+        width_ = width;
+    }
+
+    auto it = by_index_.find(index);
+    if (it != by_index_.end()) {
+        if (it->second->hash == post.hash) {
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->card;
+        }
+        lru_.erase(it->second);
+        by_index_.erase(it);
+    }
+
+    lru_.push_front({index, post.hash, post_card(post.text, static_cast<int>(index), width)});
+    by_index_[index] = lru_.begin();
+
+    if (lru_.size() > CAPACITY) {
+        by_index_.erase(lru_.back().index);
+        lru_.pop_back();
+    }
+    return lru_.front().card;
+}
+
+void PostCardCache::clear() {
+    lru_.clear();
+    by_index_.clear();
+}
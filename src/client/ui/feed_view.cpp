@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "client/ui/feed_view.hpp"
+
+#include <algorithm>
+
+int FeedView::viewport_rows() const {
+    int rows = box_.y_max - box_.y_min + 1;
+    return rows > 0 ? rows : FALLBACK_ROWS;
+}
+
+int FeedView::width() const {
+    int columns = box_.x_max - box_.x_min + 1;
+    return box_.y_max >= box_.y_min && columns > 0 ? columns : FALLBACK_COLUMNS;
+}
+
+size_t FeedView::max_first(size_t count, const HeightFn& height) const {
+    int rows = viewport_rows();
+    int used = 0;
+    size_t i = count;
+    while (i > 0 && used + height(i - 1) <= rows) {
+        used += height(--i);
+    }
+    // A single card taller than the viewport still gets its own page
+    return i == count && count > 0 ? count - 1 : i;
+}
+
+Element FeedView::render(size_t count, const CardFn& card, const HeightFn& height) {
+    first_ = std::min(first_, max_first(count, height));
+
+    const int rows = viewport_rows();
+    Elements items;
+    int used = 0;
+    size_t i = first_;
+    shown_ = 0;
+    for (; i < count && used < rows; ++i) {
+        items.push_back(card(i));
+        used += height(i);
+        if (used <= rows) shown_++;
+    }
+    for (size_t extra = 0; i < count && extra < OVERSCAN; ++i, ++extra) {
+        items.push_back(card(i));
+    }
+    shown_ = std::max<size_t>(shown_, items.empty() ? 0 : 1);
+
+    return vbox(std::move(items)) | frame | reflect(box_);
+}
+
+bool FeedView::on_event(Event event, size_t count, const HeightFn& height) {
+    size_t page = std::max<size_t>(1, shown_);
+    size_t last = max_first(count, height);
+
+    if (event == Event::PageDown) {
+        first_ = std::min(first_ + page, last);
+    } else if (event == Event::PageUp) {
+        first_ -= std::min(first_, page);
+    } else if (event == Event::Home) {
+        first_ = 0;
+    } else if (event == Event::End) {
+        first_ = last;
+    } else if (event.is_mouse() && box_.Contain(event.mouse().x, event.mouse().y)) {
+        if (event.mouse().button == Mouse::WheelDown) {
+            first_ = std::min(first_ + 1, last);
+        } else if (event.mouse().button == Mouse::WheelUp) {
+            first_ -= std::min<size_t>(first_, 1);
+        } else {
+            return false;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string FeedView::position(size_t count) const {
+    if (count == 0) return "";
+    size_t from = std::min(first_, count - 1) + 1;
+    size_t to = std::min(count, first_ + shown_);
+    return std::to_string(from) + "-" + std::to_string(std::max(from, to)) +
+           " of " + std::to_string(count);
+}
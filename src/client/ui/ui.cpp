@@ -19,11 +19,63 @@
 #include "client/config.hpp"
 #include <ftxui/dom/elements.hpp>
 #include <ftxui/component/component.hpp>
+#include <algorithm>
 #include <vector>
 #include <string>
+#include <string_view>
 
 using namespace ftxui;
 
+namespace {
+
+size_t utf8_next(std::string_view s, size_t i) {
+    ++i;
+    while (i < s.size() && (static_cast<unsigned char>(s[i]) & 0xC0) == 0x80) ++i;
+    return i;
+}
+
+// Cuts one line into pieces of at most `width` characters, at a space
+// when there is one
+void wrap_line(std::string_view line, size_t width, std::vector<std::string>& out) {
+    for (;;) {
+        size_t chars = 0;
+        size_t cut = std::string_view::npos;
+        size_t last_space = std::string_view::npos;
+        for (size_t i = 0; i < line.size(); i = utf8_next(line, i)) {
+            if (chars == width) {
+                cut = i;
+                break;
+            }
+            if (line[i] == ' ') last_space = i;
+            chars++;
+        }
+        if (cut == std::string_view::npos) {
+            out.emplace_back(line);
+            return;
+        }
+
+        size_t end = (last_space != std::string_view::npos && last_space > 0) ? last_space : cut;
+        out.emplace_back(line.substr(0, end));
+        line.remove_prefix(end);
+        if (!line.empty() && line[0] == ' ') line.remove_prefix(1);
+    }
+}
+
+std::vector<std::string> wrap_post(std::string_view post, size_t width) {
+    std::vector<std::string> lines;
+    for (;;) {
+        size_t eol = post.find('\n');
+        std::string_view line = post.substr(0, eol);
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+        wrap_line(line, width, lines);
+        if (eol == std::string_view::npos) break;
+        post.remove_prefix(eol + 1);
+    }
+    return lines;
+}
+
+}
+
 Element cyber_banner() {
     return vbox({
         text("╔════════════════════════════════════════════════════════════════╗") | color(Color::Red) | bold,
@@ -98,10 +150,24 @@ Element loading_screen(int progress, int frame) {
     }) | border | borderStyled(ROUNDED);
 }
 
-Element post_card(const std::string& post, int index) {
+PostCard post_card(const std::string& post, int index, int width) {
     Color card_color = (index % 2 == 0) ? Color::Red : Color::Yellow;
     std::string header = "Anonymous #" + std::to_string(index + 1);
-    return vbox({
+
+    // text() does not break lines, so the post is split here, inside the border
+    auto lines = wrap_post(post, static_cast<size_t>(std::max(8, width - 2)));
+    size_t shown = std::min(lines.size(), POST_CARD_MAX_LINES);
+    Elements body;
+    for (size_t i = 0; i < shown; ++i) {
+        body.push_back(text(lines[i]) | color(Color::White));
+    }
+    if (lines.size() > shown) {
+        body.push_back(text("… " + std::to_string(lines.size() - shown) + " more line(s)") |
+                       color(Color::GrayLight) | dim);
+    }
+    int rows = static_cast<int>(body.size()) + 4;     // border, header, separator
+
+    Element card = vbox({
         hbox({
             text("● ") | color(card_color) | bold,
             text(header) | color(Color::Yellow) | bold,
@@ -109,8 +175,9 @@ Element post_card(const std::string& post, int index) {
             text("[" + std::to_string(index + 1) + "]") | color(Color::GreenLight) | dim
         }),
         separator(),
-        text(post) | color(Color::White)
+        vbox(std::move(body))
     }) | border | borderStyled(ROUNDED);
+    return {card, rows};
 }
 
 Component create_gate_input_component(
@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "gate/federation/federation.hpp"
+
+#include <curl/curl.h>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+static size_t gossip_write_cb(char* ptr, size_t size, size_t nmemb, void* userdata) {
+    std::string* out = static_cast<std::string*>(userdata);
+    out->append(ptr, size * nmemb);
+    return size * nmemb;
+}
+
+std::string encode_gossip(const GossipMessage& msg) {
+    std::string out = "gossip " + std::to_string(msg.sender) + "\n";
+    for (const auto& [origin, seq] : msg.vv) {
+        out += "vv " + std::to_string(origin) + " " + std::to_string(seq) + "\n";
+    }
+    for (const auto& c : msg.changes) {
+        out += "c " + std::to_string(c.origin) + " " + std::to_string(c.seq) + " " +
+               std::to_string(c.stamp) + " " + (c.added ? "+" : "-") + c.address.to_string() + "\n";
+    }
+    return out;
+}
+
+bool decode_gossip(const std::string& body, GossipMessage& msg) {
+    std::istringstream in(body);
+    std::string line;
+
+    if (!std::getline(in, line)) return false;
+    {
+        std::istringstream header(line);
+        std::string tag;
+        if (!(header >> tag >> msg.sender) || tag != "gossip") return false;
+    }
+
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        std::string tag;
+        if (!(ls >> tag)) continue;
+
+        if (tag == "vv") {
+            uint64_t origin, seq;
+            if (!(ls >> origin >> seq)) return false;
+            msg.vv[origin] = seq;
+        } else if (tag == "c") {
+            GossipChange c;
+            std::string addr;
+            if (!(ls >> c.origin >> c.seq >> c.stamp >> addr) || addr.size() < 2) return false;
+            if (addr[0] != '+' && addr[0] != '-') return false;
+            c.added = addr[0] == '+';
+            auto onion = OnionAddress::parse(std::string_view(addr).substr(1));
+            if (!onion) return false;
+            c.address = *onion;
+            msg.changes.push_back(std::move(c));
+        }
+    }
+    return true;
+}
+
+std::vector<std::string> load_gate_peers(const std::string& filepath) {
+    std::vector<std::string> peers;
+    std::ifstream file(filepath);
+    std::string line;
+    while (std::getline(file, line)) {
+        line.erase(0, line.find_first_not_of(" \t\r\n"));
+        line.erase(line.find_last_not_of(" \t\r\n") + 1);
+        if (auto onion = OnionAddress::parse(line)) {
+            peers.push_back(onion->to_string());
+        }
+    }
+    return peers;
+}
+
+std::string load_gate_secret(const std::string& filepath) {
+    std::ifstream file(filepath);
+    std::string line;
+    std::getline(file, line);
+    line.erase(0, line.find_first_not_of(" \t\r\n"));
+    line.erase(line.find_last_not_of(" \t\r\n") + 1);
+    if (line.size() < GateFederation::MIN_SECRET_SIZE) return "";
+    return line;
+}
+
+GateFederation::GateFederation(PionnierRegistry& registry, std::vector<std::string> peers,
+                               std::string secret, int socks_port, FederationLog log)
+    : registry_(registry), peers_(std::move(peers)), secret_(std::move(secret)),
+      proxy_("socks5h://127.0.0.1:" + std::to_string(socks_port)), log_(std::move(log)) {}
+
+GateFederation::~GateFederation() {
+    stop();
+}
+
+void GateFederation::start() {
+    if (peers_.empty() || running_.exchange(true)) return;
+    registry_.set_federated(true);
+    worker_ = std::thread([this] { run(); });
+}
+
+void GateFederation::stop() {
+    if (!running_.exchange(false)) return;
+    wake_cv_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+void GateFederation::notify() {
+    {
+        std::lock_guard<std::mutex> lk(wake_mtx_);
+        pending_ = true;
+    }
+    wake_cv_.notify_all();
+}
+
+void GateFederation::run() {
+    while (running_.load()) {
+        for (const auto& peer : peers_) {
+            if (!running_.load()) break;
+            // Keep pushing while batches come out full (initial sync)
+            for (int i = 0; i < 16 && gossip_with(peer); ++i) {}
+        }
+
+        std::unique_lock<std::mutex> lk(wake_mtx_);
+        wake_cv_.wait_for(lk, ROUND_INTERVAL, [this] { return pending_ || !running_.load(); });
+        if (pending_) {
+            // Let a burst of registrations pile up into one push
+            wake_cv_.wait_for(lk, BATCH_WINDOW, [this] { return !running_.load(); });
+            pending_ = false;
+        }
+    }
+}
+
+// Returns true if another round with this peer is needed right away
+bool GateFederation::gossip_with(const std::string& peer) {
+    GossipMessage out;
+    out.sender = registry_.origin_id();
+    out.vv = registry_.version_vector();
+    out.changes = registry_.changes_for(peer_vv_[peer], BATCH_LIMIT);
+    std::string body = encode_gossip(out);
+
+    CURL* curl = curl_easy_init();
+    if (!curl) return false;
+
+    std::string key_header = std::string(KEY_HEADER) + ": " + secret_;
+    curl_slist* headers = curl_slist_append(nullptr, key_header.c_str());
+
+    std::string url = "http://" + peer + "/gossip";
+    std::string response;
+    long http_code = 0;
+
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_POST, 1L);
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(body.size()));
+    curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, gossip_write_cb);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
+    curl_easy_setopt(curl, CURLOPT_PROXY, proxy_.c_str());
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 30L);
+
+    CURLcode res = curl_easy_perform(curl);
+    if (res == CURLE_OK) {
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &http_code);
+    }
+    curl_easy_cleanup(curl);
+    curl_slist_free_all(headers);
+
+    if (res != CURLE_OK || http_code != 200) {
+        log("Gossip with " + peer + " failed: " +
+                (res != CURLE_OK ? std::string(curl_easy_strerror(res))
+                                 : "HTTP " + std::to_string(http_code)), 2);
+        return false;
+    }
+
+    GossipMessage in;
+    if (!decode_gossip(response, in)) {
+        log("Gossip with " + peer + ": malformed response", 2);
+        return false;
+    }
+
+    size_t applied = registry_.apply_remote(in.changes);
+    peer_vv_[peer] = in.vv;
+
+    if (!out.changes.empty() || applied > 0) {
+        log("Gossip " + peer.substr(0, 16) + "...: sent " + std::to_string(out.changes.size()) +
+                ", received " + std::to_string(in.changes.size()) +
+                " (" + std::to_string(applied) + " new)", 1);
+    }
+
+    return out.changes.size() == BATCH_LIMIT || in.changes.size() == BATCH_LIMIT;
+}
+
+void GateFederation::log(const std::string& msg, int type) const {
+    if (log_) log_(msg, type);
+}
+
+bool GateFederation::authorized(std::string_view key) const {
+    // Constant time, the key length is no secret
+    if (secret_.empty() || key.size() != secret_.size()) return false;
+    unsigned char diff = 0;
+    for (size_t i = 0; i < key.size(); ++i) {
+        diff |= static_cast<unsigned char>(key[i] ^ secret_[i]);
+    }
+    return diff == 0;
+}
+
+std::string GateFederation::handle_gossip(const std::string& body) {
+    GossipMessage in;
+    if (!decode_gossip(body, in)) {
+        throw std::runtime_error("Malformed gossip");
+    }
+
+    size_t applied = registry_.apply_remote(in.changes);
+    if (applied > 0) {
+        log("Gossip from " + std::to_string(in.sender) + ": " +
+                std::to_string(applied) + " new change(s)", 1);
+    }
+
+    GossipMessage out;
+    out.sender = registry_.origin_id();
+    out.vv = registry_.version_vector();
+    out.changes = registry_.changes_for(in.vv, BATCH_LIMIT);
+    return encode_gossip(out);
+}
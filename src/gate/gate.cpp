@@ -32,11 +32,13 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
+#endif
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
@@ -44,6 +46,7 @@
 #include <boost/asio/ip/tcp.hpp>
 
 #include <nlohmann/json.hpp>
+#include <curl/curl.h>
 
 #include <ftxui/screen/screen.hpp>
 #include <ftxui/dom/elements.hpp>
@@ -58,8 +61,15 @@
 #include <thread>
 #include <chrono>
 #include <mutex>
+#include <optional>
+#include <memory>
+#include <sstream>
 
+#include "utils/http/http_server.hpp"
 #include "utils/tor/tor_launcher.hpp"
+#include "utils/ui/redraw_scheduler.hpp"
+#include "gate/registry/registry.hpp"
+#include "gate/federation/federation.hpp"
 
 using json = nlohmann::json;
 namespace beast = boost::beast;
@@ -70,9 +80,8 @@ namespace fs    = std::filesystem;
 using namespace ftxui;
 
 // ---------------------- Data -------------------------
-std::vector<std::string> Pioners = {
-    "5krka4isaabbpp7fbs3rqacryhvzxpx2b6sirabhbo73bolfbjs5yrqd.onion"
-};
+PionnierRegistry Pioners;
+std::unique_ptr<GateFederation> federation;
 
 std::atomic<bool> server_running{false};
 std::atomic<int> total_requests{0};
@@ -88,45 +97,99 @@ struct LogEntry {
 std::vector<LogEntry> logs;
 std::mutex logs_mtx;
 
+// Every state change the screen shows goes through add_log or a request
+RedrawScheduler redraw;
+
 void add_log(const std::string& msg, int type = 0) {
-    std::lock_guard<std::mutex> lk(logs_mtx);
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    char buf[32];
-    std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&time));
-
-    logs.push_back({std::string(buf), msg, type});
-    if (logs.size() > 50) logs.erase(logs.begin());
+    {
+        std::lock_guard<std::mutex> lk(logs_mtx);
+        auto now = std::chrono::system_clock::now();
+        auto time = std::chrono::system_clock::to_time_t(now);
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&time));
+
+        logs.push_back({std::string(buf), msg, type});
+        if (logs.size() > 50) logs.erase(logs.begin());
+    }
+    redraw.mark_dirty();
 }
 
 // ---------------------- Server Logic -------------------------
 std::string getActivePioners() {
     std::string result;
-    for (const auto& p : Pioners) {
-        result += p + "\n";
+    for (const auto& p : Pioners.snapshot()) {
+        result += p.to_string() + "\n";
     }
     return result;
 }
 
-std::string addPionnier(std::string onion_addr) {
-    Pioners.push_back(onion_addr);
+std::string addPionnier(const OnionAddress& onion_addr) {
+    if (!Pioners.add(onion_addr)) {
+        return "Pionnier already registered";
+    }
+    if (federation) federation->notify();
     return "Pionnier added successfully";
 }
 
+// Splits "/path?a=1&b=2" into path and query; value lookup by key
+std::string target_path(beast::string_view target) {
+    auto q = target.find('?');
+    return std::string(target.substr(0, q));
+}
+
+std::optional<std::string> query_param(beast::string_view target, const std::string& key) {
+    auto q = target.find('?');
+    if (q == beast::string_view::npos) return std::nullopt;
+
+    std::string query(target.substr(q + 1));
+    std::stringstream ss(query);
+    std::string pair;
+    while (std::getline(ss, pair, '&')) {
+        auto eq = pair.find('=');
+        if (pair.substr(0, eq) == key) {
+            return eq == std::string::npos ? std::string() : pair.substr(eq + 1);
+        }
+    }
+    return std::nullopt;
+}
+
 void handle_request(const http::request<http::string_body>& req,
                     http::response<http::string_body>& res)
 {
     total_requests++;
+    std::string path = target_path(req.target());
 
-    if (req.method() == http::verb::get && req.target() == "/get_pionniers")
+    if (req.method() == http::verb::get && path == "/get_pionniers")
     {
-        add_log("GET /get_pionniers - Returned " + std::to_string(Pioners.size()) + " pioneers", 1);
-        res.result(http::status::ok);
-        res.set(http::field::content_type, "text/plain");
-        res.body() = getActivePioners();
+        auto since = query_param(req.target(), "since");
+        if (since) {
+            // Delta sync: only changes after the client's version
+            try {
+                auto epoch = query_param(req.target(), "epoch");
+                uint64_t since_version = std::stoull(*since);
+                uint64_t since_epoch = epoch ? std::stoull(*epoch) : 0;
+
+                res.result(http::status::ok);
+                res.set(http::field::content_type, "text/plain");
+                res.body() = Pioners.render_since(since_epoch, since_version);
+                add_log("GET /get_pionniers?since=" + *since + " - Version " +
+                        std::to_string(Pioners.version()), 1);
+            }
+            catch (const std::exception&) {
+                add_log("Bad since parameter: " + *since, 2);
+                res.result(http::status::bad_request);
+                res.set(http::field::content_type, "text/plain");
+                res.body() = "Invalid since";
+            }
+        } else {
+            add_log("GET /get_pionniers - Returned " + std::to_string(Pioners.size()) + " pioneers", 1);
+            res.result(http::status::ok);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = getActivePioners();
+        }
         res.prepare_payload();
     }
-    else if (req.method() == http::verb::post && req.target() == "/add_pionnier")
+    else if (req.method() == http::verb::post && path == "/add_pionnier")
     {
         try {
             json parsed = json::parse(req.body());
@@ -136,11 +199,19 @@ void handle_request(const http::request<http::string_body>& req,
             }
 
             std::string onion_addr = parsed["onion_address"].get<std::string>();
-            add_log("POST /add_pionnier - Added: " + onion_addr, 1);
-
-            res.result(http::status::ok);
+            auto onion = OnionAddress::parse(onion_addr);
             res.set(http::field::content_type, "text/plain");
-            res.body() = addPionnier(onion_addr);
+
+            if (!onion) {
+                // Not a v3 address or a broken checksum
+                add_log("POST /add_pionnier - Rejected: " + onion_addr, 2);
+                res.result(http::status::bad_request);
+                res.body() = "Invalid onion address";
+            } else {
+                add_log("POST /add_pionnier - Added: " + onion_addr, 1);
+                res.result(http::status::ok);
+                res.body() = addPionnier(*onion);
+            }
         }
         catch (const std::exception& e) {
             add_log(std::string("JSON parse error: ") + e.what(), 2);
@@ -150,6 +221,51 @@ void handle_request(const http::request<http::string_body>& req,
         }
         res.prepare_payload();
     }
+    else if (req.method() == http::verb::post && path == "/add_pionniers")
+    {
+        // Batch registration: newline separated addresses, all or nothing
+        std::vector<OnionAddress> batch;
+        std::string error;
+        res.set(http::field::content_type, "text/plain");
+
+        if (parse_onion_batch(req.body(), batch, error)) {
+            size_t added = Pioners.add_batch(batch);
+            if (added > 0 && federation) federation->notify();
+            add_log("POST /add_pionniers - Added " + std::to_string(added) +
+                    " of " + std::to_string(batch.size()), 1);
+
+            res.result(http::status::ok);
+            res.body() = "added " + std::to_string(added) + " of " + std::to_string(batch.size()) + "\n";
+        } else {
+            add_log("Batch rejected: " + error, 2);
+            res.result(http::status::bad_request);
+            res.body() = "Invalid batch: " + error + "\n";
+        }
+        res.prepare_payload();
+    }
+    else if (req.method() == http::verb::post && path == "/gossip" && federation)
+    {
+        if (!federation->authorized(req[GateFederation::KEY_HEADER])) {
+            add_log("Gossip refused: bad or missing key", 2);
+            res.result(http::status::forbidden);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = "Forbidden";
+            res.prepare_payload();
+            return;
+        }
+        try {
+            res.result(http::status::ok);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = federation->handle_gossip(req.body());
+        }
+        catch (const std::exception& e) {
+            add_log(std::string("Gossip error: ") + e.what(), 2);
+            res.result(http::status::bad_request);
+            res.set(http::field::content_type, "text/plain");
+            res.body() = "Invalid gossip";
+        }
+        res.prepare_payload();
+    }
     else {
         add_log("404: " + std::string(req.target()), 2);
         res.result(http::status::not_found);
@@ -181,11 +297,11 @@ Element gate_banner() {
 Element pioneers_box() {
     Elements pioneer_list;
     int idx = 1;
-    for (const auto& p : Pioners) {
+    for (const auto& p : Pioners.snapshot()) {
         pioneer_list.push_back(
             hbox({
                 text(std::to_string(idx++) + ". ") | color(Color::Yellow),
-                text(p) | color(Color::GreenLight)
+                text(p.to_string()) | color(Color::GreenLight)
             })
         );
     }
@@ -213,6 +329,10 @@ Element stats_box() {
         hbox({
             text("Pionniers Served: ") | color(Color::White),
             text(std::to_string(Pioners.size())) | color(Color::Magenta) | bold
+        }),
+        hbox({
+            text("Federated Gates: ") | color(Color::White),
+            text(std::to_string(federation ? federation->peer_count() : 0)) | color(Color::Cyan) | bold
         })
     }) | border | size(WIDTH, EQUAL, 40);
 }
@@ -237,8 +357,10 @@ Element status_box() {
         text(onion_address.empty() ? "Initializing..." : onion_address) | color(Color::GreenLight) | dim,
         text(""),
         text("Endpoints:") | color(Color::White) | bold,
-        text("  GET  /get_pionniers") | color(Color::Cyan),
-        text("  POST /add_pionnier") | color(Color::Magenta)
+        text("  GET  /get_pionniers[?since=]") | color(Color::Cyan),
+        text("  POST /add_pionnier") | color(Color::Magenta),
+        text("  POST /add_pionniers") | color(Color::Magenta),
+        text("  POST /gossip") | color(Color::Magenta)
     }) | border | flex;
 }
 
@@ -274,20 +396,65 @@ int main() {
     try {
         fs::path exe_folder = fs::current_path();
 
+        // Registry survives restarts: snapshot + journal in data/gate
+        if (!Pioners.open_storage(exe_folder / "data" / "gate")) {
+            std::cerr << "Warning: registry storage unavailable, running in memory\n";
+        }
+        if (Pioners.version() == 0) {
+            Pioners.add(*OnionAddress::parse("5krka4isaabbpp7fbs3rqacryhvzxpx2b6sirabhbo73bolfbjs5yrqd.onion"));
+        }
+
+        if (curl_global_init(CURL_GLOBAL_DEFAULT) != 0) {
+            std::cerr << "curl_global_init failed\n";
+            return 1;
+        }
+
+        // Other gates to share the registry with, one .onion per line, and
+        // the secret all of them share
+        auto peers = load_gate_peers((exe_folder / "data" / "gate_peers.txt").string());
+        if (!peers.empty()) {
+            std::string secret = load_gate_secret((exe_folder / "data" / "gate_secret.txt").string());
+            if (secret.empty()) {
+                add_log("Federation off: data/gate_secret.txt missing or shorter than " +
+                        std::to_string(GateFederation::MIN_SECRET_SIZE) + " characters", 2);
+            } else {
+                federation = std::make_unique<GateFederation>(Pioners, peers, secret, 9052, add_log);
+            }
+        }
+
         auto screen = ScreenInteractive::Fullscreen();
         TorConfig config("gate", 9052, 5002);
         TorLauncher tor_launcher(exe_folder, config);
 
-        // Tor launch thread
+        // Requests are handled one at a time on the server thread
+        HttpServer server(5002, [](const HttpServer::Request& req, HttpServer::Response& res) {
+            handle_request(req, res);
+
+            // Counters changed, drawn with the next frame
+            redraw.mark_dirty();
+        });
+
+        std::atomic<bool> quitting{false};
+
+        // Tor launch thread, it ends once Tor is up and supervised
         std::thread tor_thread([&]() {
             try {
                 add_log("Launching Tor...", 0);
-                onion_address = tor_launcher.launch();
+                onion_address = tor_launcher.launch([](const TorBootstrap& status) {
+                    add_log("Tor bootstrap " + std::to_string(status.progress) + "%: " + status.summary,
+                            status.warning ? 2 : 0);
+                });
                 tor_ready = true;
                 add_log("Tor started: " + onion_address, 1);
 
-                while (server_running.load()) {
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
+                // Unattended servers: a crashed Tor comes back by itself
+                tor_launcher.supervise([](const std::string& message) {
+                    add_log(message, 2);
+                });
+
+                if (federation) {
+                    federation->start();
+                    add_log("Federation with " + std::to_string(federation->peer_count()) + " gate(s)", 0);
                 }
             } catch (const std::exception& e) {
                 add_log(std::string("Tor error: ") + e.what(), 2);
@@ -298,36 +465,14 @@ int main() {
         std::thread server_thread([&]() {
             try {
                 while (!tor_ready.load()) {
+                    if (quitting.load()) return;
                     std::this_thread::sleep_for(std::chrono::milliseconds(100));
                 }
 
                 add_log("Starting HTTP server on 127.0.0.1:5002", 0);
-                net::io_context ioc{1};
-                tcp::acceptor acceptor{ioc, {tcp::v4(), 5002}};
                 server_running = true;
                 add_log("Gate ready to serve pionniers", 1);
-                screen.PostEvent(Event::Custom);
-
-                while (server_running.load()) {
-                    tcp::socket socket{ioc};
-                    acceptor.accept(socket);
-
-                    beast::flat_buffer buffer;
-                    http::request<http::string_body> req;
-                    http::read(socket, buffer, req);
-
-                    http::response<http::string_body> res;
-                    res.version(req.version());
-                    res.keep_alive(false);
-
-                    handle_request(req, res);
-                    http::write(socket, res);
-
-                    beast::error_code ec;
-                    socket.shutdown(tcp::socket::shutdown_send, ec);
-
-                    screen.PostEvent(Event::Custom);
-                }
+                server.run();
             } catch (const std::exception& e) {
                 add_log(std::string("Server error: ") + e.what(), 2);
             }
@@ -371,23 +516,21 @@ int main() {
             return false;
         });
 
-        // UI refresh thread
-        std::thread refresh_thread([&]() {
-            while (server_running.load()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                screen.PostEvent(Event::Custom);
-            }
-        });
-
+        redraw.start(&screen);
         screen.Loop(component);
+        redraw.stop();
 
-        // Cleanup
+        // Cleanup, a launch still in progress gives up
+        quitting = true;
         server_running = false;
+        tor_launcher.cancel();
+        server.stop();
         add_log("Shutting down...", 0);
 
         if (tor_thread.joinable()) tor_thread.join();
         if (server_thread.joinable()) server_thread.join();
-        if (refresh_thread.joinable()) refresh_thread.join();
+        if (federation) federation->stop();
+        curl_global_cleanup();
 
     } catch (const std::exception& e) {
         std::cerr << "Fatal: " << e.what() << "\n";
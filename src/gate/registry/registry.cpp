@@ -0,0 +1,415 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "gate/registry/registry.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <random>
+#include <sstream>
+
+#include "utils/filesys/sync_io.hpp"
+
+namespace fs = std::filesystem;
+
+static const char* SNAPSHOT_FILE = "registry.snap";
+static const char* JOURNAL_FILE = "registry.journal";
+static const char* OLD_JOURNAL_FILE = "registry.journal.old";
+static const char* SNAPSHOT_MAGIC = "torsper-registry 1";
+
+PionnierRegistry::PionnierRegistry() {
+    std::random_device rd;
+    epoch_ = (static_cast<uint64_t>(rd()) << 32) | rd();
+    if (epoch_ == 0) epoch_ = 1;
+}
+
+void PionnierRegistry::record(bool added, const OnionAddress& address) {
+    ++version_;
+    history_.push_back({version_, added, address});
+    while (history_.size() > MAX_HISTORY) {
+        history_floor_ = history_.front().version;
+        history_.pop_front();
+    }
+}
+
+void PionnierRegistry::set_membership(bool added, const OnionAddress& address) {
+    if (added) {
+        if (!members_.insert(address).second) return;
+        entries_.push_back(address);
+    } else {
+        if (members_.erase(address) == 0) return;
+        entries_.erase(std::find(entries_.begin(), entries_.end(), address));
+    }
+    record(added, address);
+}
+
+void PionnierRegistry::set_state(const OnionAddress& address, const EntryState& st) {
+    states_[address] = st;
+    uint64_t& seen = vv_[st.origin];
+    seen = std::max(seen, st.seq);
+    clock_ = std::max(clock_, st.stamp);
+    if (st.origin == epoch_) local_seq_ = std::max(local_seq_, st.seq);
+
+    set_membership(st.alive, address);
+
+    if (journal_.is_open()) {
+        journal_ << "j " << st.origin << " " << st.seq << " " << st.stamp << " "
+                 << (st.alive ? "+" : "-") << address.to_string() << "\n";
+        ++journal_entries_;
+    }
+}
+
+bool PionnierRegistry::apply_local(bool added, const OnionAddress& address) {
+    std::string snapshot;
+    bool changed;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        changed = apply_local_locked(added, address);
+        flush_journal_locked(snapshot);
+    }
+    compact(snapshot);
+    return changed;
+}
+
+bool PionnierRegistry::apply_local_locked(bool added, const OnionAddress& address) {
+    if (members_.count(address) == (added ? 1u : 0u)) return false;
+
+    set_state(address, {epoch_, local_seq_ + 1, clock_ + 1, added});
+    return true;
+}
+
+bool PionnierRegistry::add(const OnionAddress& address) {
+    return apply_local(true, address);
+}
+
+bool PionnierRegistry::remove(const OnionAddress& address) {
+    return apply_local(false, address);
+}
+
+size_t PionnierRegistry::add_batch(const std::vector<OnionAddress>& addresses) {
+    std::string snapshot;
+    size_t added = 0;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (const auto& address : addresses) {
+            if (apply_local_locked(true, address)) ++added;
+        }
+        flush_journal_locked(snapshot);
+    }
+    compact(snapshot);
+    return added;
+}
+
+uint64_t PionnierRegistry::epoch() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return epoch_;
+}
+
+uint64_t PionnierRegistry::version() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return version_;
+}
+
+size_t PionnierRegistry::size() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return entries_.size();
+}
+
+std::vector<OnionAddress> PionnierRegistry::snapshot() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return entries_;
+}
+
+bool PionnierRegistry::changes_since_locked(uint64_t since_epoch, uint64_t since,
+                                            std::vector<RegistryChange>& out) const {
+    if (since_epoch != epoch_ || since < history_floor_ || since > version_) {
+        return false;
+    }
+
+    // history_ is sorted by version, skip everything the caller already has
+    auto it = std::upper_bound(history_.begin(), history_.end(), since,
+        [](uint64_t v, const RegistryChange& c) { return v < c.version; });
+    out.assign(it, history_.end());
+    return true;
+}
+
+bool PionnierRegistry::changes_since(uint64_t since_epoch, uint64_t since,
+                                     std::vector<RegistryChange>& out) const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return changes_since_locked(since_epoch, since, out);
+}
+
+std::string PionnierRegistry::render_since(uint64_t since_epoch, uint64_t since) const {
+    std::lock_guard<std::mutex> lk(mtx_);
+
+    std::vector<RegistryChange> changes;
+    bool delta = changes_since_locked(since_epoch, since, changes);
+
+    std::string result = (delta ? "delta " : "full ") +
+        std::to_string(epoch_) + " " + std::to_string(version_) +
+        (federated_ ? " federated" : "") + "\n";
+
+    if (delta) {
+        for (const auto& c : changes) {
+            result += (c.added ? "+" : "-") + c.address.to_string() + "\n";
+        }
+    } else {
+        for (const auto& p : entries_) {
+            result += "+" + p.to_string() + "\n";
+        }
+    }
+    return result;
+}
+
+void PionnierRegistry::set_federated(bool federated) {
+    std::lock_guard<std::mutex> lk(mtx_);
+    federated_ = federated;
+}
+
+VersionVector PionnierRegistry::version_vector() const {
+    std::lock_guard<std::mutex> lk(mtx_);
+    return vv_;
+}
+
+std::vector<GossipChange> PionnierRegistry::changes_for(const VersionVector& peer_vv,
+                                                        size_t limit) const {
+    std::vector<GossipChange> out;
+    {
+        std::lock_guard<std::mutex> lk(mtx_);
+        for (const auto& [address, st] : states_) {
+            auto it = peer_vv.find(st.origin);
+            if (it != peer_vv.end() && st.seq <= it->second) continue;
+            out.push_back({st.origin, st.seq, st.stamp, st.alive, address});
+        }
+    }
+
+    std::sort(out.begin(), out.end(), [](const GossipChange& a, const GossipChange& b) {
+        return a.origin != b.origin ? a.origin < b.origin : a.seq < b.seq;
+    });
+    if (out.size() > limit) out.resize(limit);
+    return out;
+}
+
+size_t PionnierRegistry::apply_remote(const std::vector<GossipChange>& changes) {
+    std::string snapshot;
+    size_t applied = 0;
+    std::unique_lock<std::mutex> lk(mtx_);
+
+    std::unordered_set<uint64_t> refused;   // origins, their later changes wait too
+    for (const auto& c : changes) {
+        if (refused.count(c.origin)) continue;
+        if (c.stamp > clock_ && c.stamp - clock_ > MAX_CLOCK_LEAD) {
+            refused.insert(c.origin);
+            continue;
+        }
+
+        uint64_t& seen = vv_[c.origin];
+        seen = std::max(seen, c.seq);
+        clock_ = std::max(clock_, c.stamp);
+
+        auto it = states_.find(c.address);
+        if (it != states_.end()) {
+            const EntryState& cur = it->second;
+            if (std::make_pair(c.stamp, c.origin) <= std::make_pair(cur.stamp, cur.origin)) {
+                continue;
+            }
+        }
+
+        uint64_t before = version_;
+        set_state(c.address, {c.origin, c.seq, c.stamp, c.added});
+        if (version_ != before) ++applied;
+    }
+    flush_journal_locked(snapshot);
+    lk.unlock();
+
+    compact(snapshot);
+    return applied;
+}
+
+// ---------------------- Storage -------------------------
+bool PionnierRegistry::open_storage(const fs::path& dir) {
+    std::lock_guard<std::mutex> lk(mtx_);
+
+    std::error_code ec;
+    fs::create_directories(dir, ec);
+    storage_dir_ = dir;
+
+    load_snapshot_locked(dir / SNAPSHOT_FILE);
+    replay_journal_locked(dir / OLD_JOURNAL_FILE);
+    replay_journal_locked(dir / JOURNAL_FILE);
+
+    // Fold the replayed journals into a fresh snapshot and start a new one
+    if (!write_snapshot(render_snapshot_locked())) return false;
+    fs::remove(dir / OLD_JOURNAL_FILE, ec);
+    journal_.open(dir / JOURNAL_FILE, std::ios::trunc);
+    journal_entries_ = 0;
+    return journal_.is_open();
+}
+
+bool PionnierRegistry::load_snapshot_locked(const fs::path& path) {
+    std::ifstream in(path);
+    if (!in) return false;
+
+    std::string line;
+    if (!std::getline(in, line) || line != SNAPSHOT_MAGIC) return false;
+
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        std::string tag;
+        ls >> tag;
+
+        if (tag == "meta") {
+            ls >> epoch_ >> version_ >> local_seq_ >> clock_;
+        } else if (tag == "vv") {
+            uint64_t origin, seq;
+            if (ls >> origin >> seq) vv_[origin] = seq;
+        } else if (tag == "e") {
+            EntryState st;
+            std::string addr;
+            if (!(ls >> st.origin >> st.seq >> st.stamp >> addr) || addr.size() < 2) continue;
+            auto onion = OnionAddress::parse(std::string_view(addr).substr(1));
+            if (!onion) continue;
+            st.alive = addr[0] == '+';
+
+            states_[*onion] = st;
+            if (st.alive && members_.insert(*onion).second) entries_.push_back(*onion);
+        }
+    }
+
+    // Changes before the snapshot are not in the history any more
+    history_.clear();
+    history_floor_ = version_;
+    return true;
+}
+
+void PionnierRegistry::replay_journal_locked(const fs::path& path) {
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        std::istringstream ls(line);
+        std::string tag, addr;
+        EntryState st;
+        // A torn last line from a crash simply fails to parse
+        if (!(ls >> tag >> st.origin >> st.seq >> st.stamp >> addr) || tag != "j" || addr.size() < 2) {
+            continue;
+        }
+        auto onion = OnionAddress::parse(std::string_view(addr).substr(1));
+        if (!onion) continue;
+        st.alive = addr[0] == '+';
+
+        // Already in the snapshot (a journal set aside before a crash)
+        auto it = states_.find(*onion);
+        if (it != states_.end() &&
+            std::make_pair(st.stamp, st.origin) <= std::make_pair(it->second.stamp, it->second.origin)) {
+            continue;
+        }
+        set_state(*onion, st);
+    }
+}
+
+std::string PionnierRegistry::render_snapshot_locked() const {
+    std::ostringstream out;
+    out << SNAPSHOT_MAGIC << "\n";
+    out << "meta " << epoch_ << " " << version_ << " " << local_seq_ << " " << clock_ << "\n";
+    for (const auto& [origin, seq] : vv_) {
+        out << "vv " << origin << " " << seq << "\n";
+    }
+    // Live entries in registration order first, then tombstones
+    for (const auto& addr : entries_) {
+        const EntryState& st = states_.at(addr);
+        out << "e " << st.origin << " " << st.seq << " " << st.stamp << " +" << addr.to_string() << "\n";
+    }
+    for (const auto& [addr, st] : states_) {
+        if (st.alive) continue;
+        out << "e " << st.origin << " " << st.seq << " " << st.stamp << " -" << addr.to_string() << "\n";
+    }
+    return out.str();
+}
+
+bool PionnierRegistry::write_snapshot(const std::string& data) const {
+    fs::path path = storage_dir_ / SNAPSHOT_FILE;
+    fs::path tmp = path;
+    tmp += ".tmp";
+
+    if (!sync_io::write_file(tmp, data)) return false;
+
+    std::error_code ec;
+    fs::rename(tmp, path, ec);
+    return !ec && sync_io::sync_dir(storage_dir_);
+}
+
+void PionnierRegistry::flush_journal_locked(std::string& snapshot) {
+    if (!journal_.is_open()) return;
+    journal_.flush();
+
+    if (journal_entries_ < JOURNAL_COMPACT_AT || compacting_) return;
+
+    // Set the journal aside, unless the last attempt left one there that
+    // no snapshot holds yet. Then the next snapshot just covers both.
+    if (!old_journal_) {
+        const fs::path path = storage_dir_ / JOURNAL_FILE;
+        std::error_code ec;
+        journal_.close();
+        fs::rename(path, storage_dir_ / OLD_JOURNAL_FILE, ec);
+        if (ec) {
+            journal_.open(path, std::ios::app);
+            journal_entries_ = 0;
+            return;
+        }
+        journal_.open(path, std::ios::trunc);
+        old_journal_ = true;
+    }
+    journal_entries_ = 0;
+    compacting_ = true;
+    snapshot = render_snapshot_locked();
+}
+
+void PionnierRegistry::compact(const std::string& snapshot) {
+    if (snapshot.empty()) return;
+
+    bool written = write_snapshot(snapshot);
+    std::error_code ec;
+    if (written) fs::remove(storage_dir_ / OLD_JOURNAL_FILE, ec);
+
+    std::lock_guard<std::mutex> lk(mtx_);
+    compacting_ = false;
+    if (written) old_journal_ = false;
+}
+
+bool parse_onion_batch(std::string_view body, std::vector<OnionAddress>& out, std::string& error) {
+    out.reserve(body.size() / 63);
+
+    size_t line_no = 0;
+    while (!body.empty()) {
+        size_t nl = body.find('\n');
+        std::string_view line = body.substr(0, nl);
+        body.remove_prefix(nl == std::string_view::npos ? body.size() : nl + 1);
+        ++line_no;
+
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.back()))) line.remove_suffix(1);
+        while (!line.empty() && std::isspace(static_cast<unsigned char>(line.front()))) line.remove_prefix(1);
+        if (line.empty()) continue;
+
+        auto onion = OnionAddress::parse(line);
+        if (!onion) {
+            error = "line " + std::to_string(line_no) + ": invalid onion address";
+            return false;
+        }
+        out.push_back(*onion);
+    }
+    return true;
+}
@@ -15,11 +15,13 @@
  * along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#ifdef _WIN32
 #define WIN32_LEAN_AND_MEAN
 #define NOMINMAX
 #include <winsock2.h>
 #include <ws2tcpip.h>
 #include <windows.h>
+#endif
 
 #include <boost/beast/core.hpp>
 #include <boost/beast/http.hpp>
@@ -33,6 +35,7 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <mutex>
 #include <filesystem>
@@ -40,7 +43,10 @@
 #include <thread>
 #include <chrono>
 
+#include "pionnier/post_batch.hpp"
+#include "utils/http/http_server.hpp"
 #include "utils/tor/tor_launcher.hpp"
+#include "utils/ui/redraw_scheduler.hpp"
 
 namespace beast = boost::beast;
 namespace http  = beast::http;
@@ -69,15 +75,21 @@ struct LogEntry {
 std::vector<LogEntry> logs;
 std::mutex logs_mtx;
 
+// Every state change the screen shows goes through add_log or a request
+RedrawScheduler redraw;
+
 void add_log(const std::string& msg, int type = 0) {
-    std::lock_guard<std::mutex> lk(logs_mtx);
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    char buf[32];
-    std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&time));
-
-    logs.push_back({std::string(buf), msg, type});
-    if (logs.size() > 50) logs.erase(logs.begin());
+    {
+        std::lock_guard<std::mutex> lk(logs_mtx);
+        auto now = std::chrono::system_clock::now();
+        auto time = std::chrono::system_clock::to_time_t(now);
+        char buf[32];
+        std::strftime(buf, sizeof(buf), "%H:%M:%S", std::localtime(&time));
+
+        logs.push_back({std::string(buf), msg, type});
+        if (logs.size() > 50) logs.erase(logs.begin());
+    }
+    redraw.mark_dirty();
 }
 
 // ---------------------- Server Logic -------------------------
@@ -90,7 +102,6 @@ std::string posts_to_text() {
     return result;
 }
 
-
 void handle_request(const http::request<http::string_body>& req,
                     http::response<http::string_body>& res)
 {
@@ -119,6 +130,47 @@ void handle_request(const http::request<http::string_body>& req,
         return;
     }
 
+    if (req.method() == http::verb::post && req.target() == "/add_posts") {
+        post_requests++;
+        res.set(http::field::content_type, "text/plain");
+
+        std::vector<std::string_view> batch;
+        std::string error;
+        if (!parse_post_batch(req.body(), batch, error)) {
+            add_log("Batch rejected: " + error, 2);
+            res.result(http::status::bad_request);
+            res.body() = "Invalid batch: " + error + "\n";
+            res.prepare_payload();
+            return;
+        }
+
+        // Per-item results, the accepted posts go in under one lock
+        std::string results;
+        size_t accepted = 0;
+        {
+            std::lock_guard<std::mutex> lk(posts_mtx);
+            posts.reserve(posts.size() + batch.size());
+            for (size_t i = 0; i < batch.size(); ++i) {
+                results += std::to_string(i);
+                if (batch[i].empty()) {
+                    results += " error empty\n";
+                } else {
+                    posts.emplace_back(batch[i]);
+                    results += " ok\n";
+                    accepted++;
+                }
+            }
+        }
+
+        add_log("POST /add_posts - Added " + std::to_string(accepted) +
+                " of " + std::to_string(batch.size()), 1);
+        res.result(http::status::ok);
+        res.body() = "accepted " + std::to_string(accepted) + " of " +
+                     std::to_string(batch.size()) + "\n" + results;
+        res.prepare_payload();
+        return;
+    }
+
     add_log("404: " + std::string(req.target()), 2);
     res.result(http::status::not_found);
     res.set(http::field::content_type, "text/plain");
@@ -190,7 +242,8 @@ Element status_box() {
         text(""),
         text("Endpoints:") | color(Color::White) | bold,
         text("  GET  /get_posts") | color(Color::Cyan),
-        text("  POST /add_post") | color(Color::Magenta)
+        text("  POST /add_post") | color(Color::Magenta),
+        text("  POST /add_posts") | color(Color::Magenta)
     }) | border | flex;
 }
 
@@ -230,18 +283,32 @@ int main() {
         TorConfig config("server", 9051, 5001);
         TorLauncher tor_launcher(exe_folder, config);
 
-        // Tor launch thread
+        // Requests are handled one at a time on the server thread
+        HttpServer server(5001, [](const HttpServer::Request& req, HttpServer::Response& res) {
+            handle_request(req, res);
+
+            // Counters changed, drawn with the next frame
+            redraw.mark_dirty();
+        });
+
+        std::atomic<bool> quitting{false};
+
+        // Tor launch thread, it ends once Tor is up and supervised
         std::thread tor_thread([&]() {
             try {
 
                 add_log("Launching Tor...", 0);
-                onion_address = tor_launcher.launch();
+                onion_address = tor_launcher.launch([](const TorBootstrap& status) {
+                    add_log("Tor bootstrap " + std::to_string(status.progress) + "%: " + status.summary,
+                            status.warning ? 2 : 0);
+                });
                 tor_ready = true;
                 add_log("Tor started: " + onion_address, 1);
 
-                while (server_running.load()) {
-                    std::this_thread::sleep_for(std::chrono::seconds(1));
-                }
+                // Unattended servers: a crashed Tor comes back by itself
+                tor_launcher.supervise([](const std::string& message) {
+                    add_log(message, 2);
+                });
             } catch (const std::exception& e) {
                 add_log(std::string("Tor error: ") + e.what(), 2);
             }
@@ -251,36 +318,14 @@ int main() {
         std::thread server_thread([&]() {
             try {
                 while (!tor_ready.load()) {
+                    if (quitting.load()) return;
                     std::this_thread::sleep_for(std::chrono::milliseconds(100));
                 }
 
                 add_log("Starting HTTP server on 127.0.0.1:5001", 0);
-                net::io_context ioc{1};
-                tcp::acceptor acceptor{ioc, {tcp::v4(), 5001}};
                 server_running = true;
                 add_log("Server ready to accept connections", 1);
-                screen.PostEvent(Event::Custom);
-
-                while (server_running.load()) {
-                    tcp::socket socket{ioc};
-                    acceptor.accept(socket);
-
-                    beast::flat_buffer buffer;
-                    http::request<http::string_body> req;
-                    http::read(socket, buffer, req);
-
-                    http::response<http::string_body> res;
-                    res.version(req.version());
-                    res.keep_alive(false);
-
-                    handle_request(req, res);
-                    http::write(socket, res);
-
-                    beast::error_code ec;
-                    socket.shutdown(tcp::socket::shutdown_send, ec);
-
-                    screen.PostEvent(Event::Custom);
-                }
+                server.run();
             } catch (const std::exception& e) {
                 add_log(std::string("Server error: ") + e.what(), 2);
             }
@@ -323,23 +368,19 @@ int main() {
             return false;
         });
 
-        // UI refresh thread
-        std::thread refresh_thread([&]() {
-            while (server_running.load()) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(500));
-                screen.PostEvent(Event::Custom);
-            }
-        });
-
+        redraw.start(&screen);
         screen.Loop(component);
+        redraw.stop();
 
-        // Cleanup
+        // Cleanup, a launch still in progress gives up
+        quitting = true;
         server_running = false;
+        tor_launcher.cancel();
+        server.stop();
         add_log("Shutting down...", 0);
 
         if (tor_thread.joinable()) tor_thread.join();
         if (server_thread.joinable()) server_thread.join();
-        if (refresh_thread.joinable()) refresh_thread.join();
 
     } catch (const std::exception& e) {
         std::cerr << "Fatal: " << e.what() << "\n";
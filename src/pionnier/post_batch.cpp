@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "pionnier/post_batch.hpp"
+
+bool parse_post_batch(std::string_view body, std::vector<std::string_view>& out, std::string& error) {
+    size_t frame = 0;
+    auto fail = [&](const std::string& why) {
+        error = "frame " + std::to_string(frame) + ": " + why;
+        return false;
+    };
+
+    while (!body.empty()) {
+        size_t nl = body.find('\n');
+        if (nl == std::string_view::npos || nl == 0) return fail("bad length line");
+
+        // Capped while reading, so no digit count can overflow it
+        size_t len = 0;
+        for (char c : body.substr(0, nl)) {
+            if (c < '0' || c > '9') return fail("bad length line");
+            len = len * 10 + static_cast<size_t>(c - '0');
+            if (len > MAX_POST_SIZE) return fail("post too large");
+        }
+        body.remove_prefix(nl + 1);
+
+        if (len >= body.size() || body[len] != '\n') return fail("truncated");
+        if (++frame > MAX_BATCH_POSTS) {
+            error = "more than " + std::to_string(MAX_BATCH_POSTS) + " posts";
+            return false;
+        }
+        out.push_back(body.substr(0, len));
+        body.remove_prefix(len + 1);
+    }
+    return true;
+}
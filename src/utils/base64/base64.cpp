@@ -0,0 +1,442 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "utils/base64.hpp"
+
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BASE64_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// GCC and Clang only emit vector instructions in functions marked for them,
+// MSVC accepts the intrinsics anywhere
+#if defined(BASE64_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BASE64_TARGET(isa) __attribute__((target(isa)))
+#else
+#define BASE64_TARGET(isa)
+#endif
+
+namespace base64 {
+namespace {
+
+const char ENCODE_TABLE[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr uint8_t INVALID = 0xFF;
+
+// Vector kernels store a full register, up to this many bytes past the output
+constexpr size_t SLACK = 32;
+
+const uint8_t* decode_table() {
+    static const auto table = [] {
+        std::array<uint8_t, 256> t;
+        t.fill(INVALID);
+        for (uint8_t i = 0; i < 64; ++i) t[static_cast<uint8_t>(ENCODE_TABLE[i])] = i;
+        return t;
+    }();
+    return table.data();
+}
+
+bool is_space(unsigned char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+enum class Isa { SCALAR, SSSE3, AVX2 };
+
+Isa detect_isa() {
+#if defined(BASE64_X86)
+#if defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+    __cpuid(info, 1);
+    bool ssse3 = (info[2] & (1 << 9)) != 0;
+    bool os_avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (max_leaf >= 7 && os_avx) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    __builtin_cpu_init();
+    bool ssse3 = __builtin_cpu_supports("ssse3");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return Isa::AVX2;
+    if (ssse3) return Isa::SSSE3;
+#endif
+    return Isa::SCALAR;
+}
+
+Isa isa() {
+    static const Isa detected = detect_isa();
+    return detected;
+}
+
+void encode_triple(const uint8_t* in, char* out) {
+    uint32_t bits = (uint32_t(in[0]) << 16) | (uint32_t(in[1]) << 8) | in[2];
+    out[0] = ENCODE_TABLE[(bits >> 18) & 0x3F];
+    out[1] = ENCODE_TABLE[(bits >> 12) & 0x3F];
+    out[2] = ENCODE_TABLE[(bits >> 6) & 0x3F];
+    out[3] = ENCODE_TABLE[bits & 0x3F];
+}
+
+// `n` is a multiple of 3
+void encode_scalar(const uint8_t* in, size_t n, char* out) {
+    for (size_t i = 0; i < n; i += 3, out += 4) encode_triple(in + i, out);
+}
+
+// Decodes whole quads until one holds anything but alphabet characters.
+// Returns the characters consumed, always a multiple of 4.
+size_t decode_scalar(const char* in, size_t n, uint8_t* out) {
+    const uint8_t* table = decode_table();
+    size_t i = 0;
+    for (; n - i >= 4; i += 4, out += 3) {
+        uint8_t a = table[static_cast<uint8_t>(in[i])];
+        uint8_t b = table[static_cast<uint8_t>(in[i + 1])];
+        uint8_t c = table[static_cast<uint8_t>(in[i + 2])];
+        uint8_t d = table[static_cast<uint8_t>(in[i + 3])];
+        if ((a | b | c | d) & 0x80) break;
+        uint32_t bits = (uint32_t(a) << 18) | (uint32_t(b) << 12) | (uint32_t(c) << 6) | d;
+        out[0] = static_cast<uint8_t>(bits >> 16);
+        out[1] = static_cast<uint8_t>(bits >> 8);
+        out[2] = static_cast<uint8_t>(bits);
+    }
+    return i;
+}
+
+#if defined(BASE64_X86)
+
+// The vector code follows Muła and Lemire, "Faster Base64 Encoding and
+// Decoding Using AVX2 Instructions" (2018): spread 3 bytes over four 6-bit
+// lanes with multiplies, map between values and ASCII with nibble lookups.
+
+BASE64_TARGET("ssse3")
+__m128i encode_lanes(__m128i in) {
+    in = _mm_shuffle_epi8(in, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10));
+    __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+    __m128i indices = _mm_or_si128(t1, t3);
+
+    __m128i shift = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+    __m128i upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+    shift = _mm_or_si128(shift, _mm_and_si128(upper, _mm_set1_epi8(13)));
+    const __m128i offsets = _mm_setr_epi8('a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                          '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    return _mm_add_epi8(_mm_shuffle_epi8(offsets, shift), indices);
+}
+
+// 12 bytes in, 16 characters out. Loads 16 bytes, so stops 4 short of the end.
+BASE64_TARGET("ssse3")
+size_t encode_ssse3(const uint8_t* in, size_t n, char* out) {
+    size_t i = 0;
+    for (; n - i >= 16; i += 12, out += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), encode_lanes(block));
+    }
+    return i;
+}
+
+BASE64_TARGET("avx2")
+size_t encode_avx2(const uint8_t* in, size_t n, char* out) {
+    const __m256i spread = _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10,
+                                            1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10);
+    const __m256i offsets = _mm256_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0,
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+
+    size_t i = 0;
+    for (; n - i >= 28; i += 24, out += 32) {
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 12));
+        __m256i block = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+
+        block = _mm256_shuffle_epi8(block, spread);
+        __m256i t0 = _mm256_and_si256(block, _mm256_set1_epi32(0x0fc0fc00));
+        __m256i t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+        __m256i t2 = _mm256_and_si256(block, _mm256_set1_epi32(0x003f03f0));
+        __m256i t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+        __m256i indices = _mm256_or_si256(t1, t3);
+
+        __m256i shift = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+        __m256i upper = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+        shift = _mm256_or_si256(shift, _mm256_and_si256(upper, _mm256_set1_epi8(13)));
+        __m256i chars = _mm256_add_epi8(_mm256_shuffle_epi8(offsets, shift), indices);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), chars);
+    }
+    return i;
+}
+
+// 16 characters in, 12 bytes out (16 stored). Stops at the first block
+// holding anything outside the alphabet, the scalar path takes it from there.
+BASE64_TARGET("ssse3")
+size_t decode_ssse3(const char* in, size_t n, uint8_t* out) {
+    const __m128i lut_lo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                         0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i lut_hi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08,
+                                         0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                           0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask_2f = _mm_set1_epi8(0x2f);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+
+    size_t i = 0;
+    for (; n - i >= 16; i += 16, out += 12) {
+        __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(chars, 4), mask_2f);
+        __m128i lo_nibbles = _mm_and_si128(chars, mask_2f);
+        __m128i hi = _mm_shuffle_epi8(lut_hi, hi_nibbles);
+        __m128i lo = _mm_shuffle_epi8(lut_lo, lo_nibbles);
+        __m128i bad = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+        if (_mm_movemask_epi8(bad) != 0xFFFF) break;
+
+        __m128i eq_2f = _mm_cmpeq_epi8(chars, mask_2f);
+        __m128i roll = _mm_shuffle_epi8(lut_roll, _mm_add_epi8(eq_2f, hi_nibbles));
+        __m128i values = _mm_add_epi8(chars, roll);
+
+        __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        merged = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(merged, pack));
+    }
+    return i;
+}
+
+// 32 characters in, 24 bytes out (32 stored)
+BASE64_TARGET("avx2")
+size_t decode_avx2(const char* in, size_t n, uint8_t* out) {
+    const __m256i lut_lo = _mm256_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m256i lut_hi = _mm256_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    const __m256i lut_roll = _mm256_setr_epi8(
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i mask_2f = _mm256_set1_epi8(0x2f);
+    const __m256i pack = _mm256_setr_epi8(
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+        2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m256i join = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+
+    size_t i = 0;
+    for (; n - i >= 32; i += 32, out += 24) {
+        __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+        __m256i hi_nibbles = _mm256_and_si256(_mm256_srli_epi32(chars, 4), mask_2f);
+        __m256i lo_nibbles = _mm256_and_si256(chars, mask_2f);
+        __m256i hi = _mm256_shuffle_epi8(lut_hi, hi_nibbles);
+        __m256i lo = _mm256_shuffle_epi8(lut_lo, lo_nibbles);
+        if (!_mm256_testz_si256(lo, hi)) break;
+
+        __m256i eq_2f = _mm256_cmpeq_epi8(chars, mask_2f);
+        __m256i roll = _mm256_shuffle_epi8(lut_roll, _mm256_add_epi8(eq_2f, hi_nibbles));
+        __m256i values = _mm256_add_epi8(chars, roll);
+
+        __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+        merged = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+        merged = _mm256_shuffle_epi8(merged, pack);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_permutevar8x32_epi32(merged, join));
+    }
+    return i;
+}
+
+#endif
+
+// Encodes `n` bytes, a multiple of 3, into exactly n / 3 * 4 characters
+void encode_run(const uint8_t* in, size_t n, char* out) {
+    size_t done = 0;
+#if defined(BASE64_X86)
+    if (isa() == Isa::AVX2) done = encode_avx2(in, n, out);
+    if (isa() != Isa::SCALAR) done += encode_ssse3(in + done, n - done, out + done / 3 * 4);
+#endif
+    encode_scalar(in + done, n - done, out + done / 3 * 4);
+}
+
+// Decodes the longest prefix of whole, unpadded quads. Returns the
+// characters consumed, the output is consumed / 4 * 3 bytes.
+size_t decode_run(const char* in, size_t n, uint8_t* out) {
+    size_t done = 0;
+#if defined(BASE64_X86)
+    if (isa() == Isa::AVX2) done = decode_avx2(in, n, out);
+    if (isa() != Isa::SCALAR) done += decode_ssse3(in + done, n - done, out + done / 4 * 3);
+#endif
+    return done + decode_scalar(in + done, n - done, out + done / 4 * 3);
+}
+
+} // namespace
+
+size_t decoded_size(std::string_view in) {
+    size_t n = in.size() / 4 * 3;
+    if (in.size() >= 4 && in.size() % 4 == 0) {
+        if (in[in.size() - 1] == '=') n--;
+        if (in[in.size() - 2] == '=') n--;
+    }
+    return n;
+}
+
+void Encoder::update(const void* data, size_t n, std::string& out) {
+    const uint8_t* in = static_cast<const uint8_t*>(data);
+    const size_t base = out.size();
+    out.resize(base + (npending_ + n) / 3 * 4);
+    char* dst = &out[0] + base;
+
+    if (npending_ > 0) {
+        while (npending_ < 3 && n > 0) {
+            pending_[npending_++] = *in++;
+            n--;
+        }
+        if (npending_ < 3) return;
+        encode_triple(pending_, dst);
+        dst += 4;
+        npending_ = 0;
+    }
+
+    size_t whole = n / 3 * 3;
+    encode_run(in, whole, dst);
+    // `in` may be null for an empty update, memcpy must not see it then
+    if (n > whole) std::memcpy(pending_, in + whole, n - whole);
+    npending_ = n - whole;
+}
+
+void Encoder::finish(std::string& out) {
+    if (npending_ == 0) return;
+
+    uint8_t tail[3] = {};
+    std::memcpy(tail, pending_, npending_);
+    char quad[4];
+    encode_triple(tail, quad);
+    if (npending_ == 1) quad[2] = '=';
+    quad[3] = '=';
+    out.append(quad, 4);
+    npending_ = 0;
+}
+
+bool Decoder::fail(const std::string& what) {
+    error_ = what;
+    return false;
+}
+
+bool Decoder::update(std::string_view in, std::vector<unsigned char>& out) {
+    if (!error_.empty()) return false;
+
+    const uint8_t* table = decode_table();
+    const size_t base = out.size();
+    out.resize(base + in.size() / 4 * 3 + 3 + SLACK);
+    uint8_t* dst = out.data() + base;
+    size_t written = 0;
+
+    auto stop = [&](const char* what) {
+        out.resize(base + written);
+        return fail(std::string(what) + " at offset " + std::to_string(position_ - 1));
+    };
+
+    size_t i = 0;
+    while (i < in.size()) {
+        // Bulk path between quad boundaries
+        if (nquad_ == 0 && !done_) {
+            size_t used = decode_run(in.data() + i, in.size() - i, dst + written);
+            written += used / 4 * 3;
+            i += used;
+            position_ += used;
+            if (i == in.size()) break;
+        }
+
+        unsigned char c = static_cast<unsigned char>(in[i++]);
+        position_++;
+        if (is_space(c)) continue;
+        if (done_) return stop("data after padding");
+
+        if (c == '=') {
+            if (nquad_ < 2) return stop("misplaced padding");
+            quad_[nquad_++] = 0;
+            padding_++;
+        } else {
+            uint8_t v = table[c];
+            if (v == INVALID) return stop("invalid character");
+            if (padding_) return stop("misplaced padding");
+            quad_[nquad_++] = v;
+        }
+        if (nquad_ < 4) continue;
+
+        uint32_t bits = (uint32_t(quad_[0]) << 18) | (uint32_t(quad_[1]) << 12) |
+                        (uint32_t(quad_[2]) << 6) | quad_[3];
+        if (padding_ && (bits & ((1u << (8 * padding_)) - 1)) != 0) {
+            return stop("non-zero trailing bits");
+        }
+        dst[written++] = static_cast<uint8_t>(bits >> 16);
+        if (padding_ < 2) dst[written++] = static_cast<uint8_t>(bits >> 8);
+        if (padding_ < 1) dst[written++] = static_cast<uint8_t>(bits);
+
+        done_ = padding_ > 0;
+        nquad_ = 0;
+        padding_ = 0;
+    }
+
+    out.resize(base + written);
+    return true;
+}
+
+bool Decoder::finish() {
+    if (!error_.empty()) return false;
+    if (nquad_ != 0) return fail("truncated input at offset " + std::to_string(position_));
+    return true;
+}
+
+std::string encode(const void* data, size_t n) {
+    std::string out;
+    out.reserve(encoded_size(n));
+    Encoder encoder;
+    encoder.update(data, n, out);
+    encoder.finish(out);
+    return out;
+}
+
+bool decode(std::string_view in, std::vector<unsigned char>& out, std::string& error) {
+    out.clear();
+    out.reserve(in.size() / 4 * 3 + 3 + SLACK);
+
+    Decoder decoder;
+    if (!decoder.update(in, out) || !decoder.finish()) {
+        error = decoder.error();
+        out.clear();
+        return false;
+    }
+    return true;
+}
+
+std::vector<unsigned char> decode(std::string_view in) {
+    std::vector<unsigned char> out;
+    std::string error;
+    if (!decode(in, out, error)) {
+        throw std::invalid_argument("base64: " + error);
+    }
+    return out;
+}
+
+}
@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "utils/onion/onion_address.hpp"
+
+namespace {
+
+constexpr std::string_view SUFFIX = ".onion";
+constexpr std::string_view CHECKSUM_PREFIX = ".onion checksum";
+constexpr char ALPHABET[] = "abcdefghijklmnopqrstuvwxyz234567";
+
+// base32 value of each character, -1 if it is not in the alphabet
+constexpr std::array<int8_t, 256> make_base32_table() {
+    std::array<int8_t, 256> t{};
+    for (auto& v : t) v = -1;
+    for (int i = 0; i < 26; ++i) {
+        t['a' + i] = static_cast<int8_t>(i);
+        t['A' + i] = static_cast<int8_t>(i);
+    }
+    for (int i = 0; i < 6; ++i) t['2' + i] = static_cast<int8_t>(26 + i);
+    return t;
+}
+constexpr auto BASE32 = make_base32_table();
+
+// ---------------------- Keccak-f[1600] -------------------------
+const uint64_t ROUND_CONSTANTS[24] = {
+    0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808aULL, 0x8000000080008000ULL,
+    0x000000000000808bULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+    0x000000000000008aULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000aULL,
+    0x000000008000808bULL, 0x800000000000008bULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+    0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800aULL, 0x800000008000000aULL,
+    0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+};
+const int ROTATIONS[24] = {1, 3, 6, 10, 15, 21, 28, 36, 45, 55, 2, 14,
+                           27, 41, 56, 8, 25, 43, 62, 18, 39, 61, 20, 44};
+const int LANES[24] = {10, 7, 11, 17, 18, 3, 5, 16, 8, 21, 24, 4,
+                       15, 23, 19, 13, 12, 2, 20, 14, 22, 9, 6, 1};
+
+inline uint64_t rotl(uint64_t x, int n) { return (x << n) | (x >> (64 - n)); }
+
+void keccak_f(uint64_t st[25]) {
+    for (int round = 0; round < 24; ++round) {
+        uint64_t bc[5];
+        for (int i = 0; i < 5; ++i) bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
+        for (int i = 0; i < 5; ++i) {
+            uint64_t t = bc[(i + 4) % 5] ^ rotl(bc[(i + 1) % 5], 1);
+            for (int j = 0; j < 25; j += 5) st[j + i] ^= t;
+        }
+
+        uint64_t t = st[1];
+        for (int i = 0; i < 24; ++i) {
+            int j = LANES[i];
+            uint64_t tmp = st[j];
+            st[j] = rotl(t, ROTATIONS[i]);
+            t = tmp;
+        }
+
+        for (int j = 0; j < 25; j += 5) {
+            for (int i = 0; i < 5; ++i) bc[i] = st[j + i];
+            for (int i = 0; i < 5; ++i) st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
+        }
+
+        st[0] ^= ROUND_CONSTANTS[round];
+    }
+}
+
+} // namespace
+
+std::array<uint8_t, 32> sha3_256(const uint8_t* data, size_t len) {
+    constexpr size_t RATE = 136;
+    uint64_t st[25] = {};
+
+    auto absorb = [&](const uint8_t* block) {
+        for (size_t i = 0; i < RATE / 8; ++i) {
+            uint64_t lane = 0;
+            for (int b = 0; b < 8; ++b) lane |= static_cast<uint64_t>(block[i * 8 + b]) << (8 * b);
+            st[i] ^= lane;
+        }
+        keccak_f(st);
+    };
+
+    while (len >= RATE) {
+        absorb(data);
+        data += RATE;
+        len -= RATE;
+    }
+
+    uint8_t last[RATE] = {};
+    if (len) std::memcpy(last, data, len);
+    last[len] ^= 0x06;          // SHA3 domain bits
+    last[RATE - 1] ^= 0x80;
+    absorb(last);
+
+    std::array<uint8_t, 32> out{};
+    for (size_t i = 0; i < out.size(); ++i) {
+        out[i] = static_cast<uint8_t>(st[i / 8] >> (8 * (i % 8)));
+    }
+    return out;
+}
+
+std::optional<OnionAddress> OnionAddress::parse(std::string_view text) {
+    if (text.size() == ENCODED_SIZE + SUFFIX.size()) {
+        std::string_view tail = text.substr(ENCODED_SIZE);
+        for (size_t i = 0; i < SUFFIX.size(); ++i) {
+            if ((tail[i] | 0x20) != SUFFIX[i]) return std::nullopt;
+        }
+        text = text.substr(0, ENCODED_SIZE);
+    }
+    if (text.size() != ENCODED_SIZE) return std::nullopt;
+
+    // 56 chars * 5 bits = 35 bytes, no padding
+    OnionAddress addr;
+    uint64_t acc = 0;
+    int bits = 0;
+    size_t out = 0;
+    for (unsigned char c : text) {
+        int v = BASE32[c];
+        if (v < 0) return std::nullopt;
+        acc = (acc << 5) | static_cast<uint64_t>(v);
+        bits += 5;
+        if (bits >= 8) {
+            bits -= 8;
+            addr.bytes_[out++] = static_cast<uint8_t>(acc >> bits);
+        }
+    }
+
+    if (addr.bytes_[34] != VERSION) return std::nullopt;
+
+    uint8_t input[CHECKSUM_PREFIX.size() + 33];
+    std::memcpy(input, CHECKSUM_PREFIX.data(), CHECKSUM_PREFIX.size());
+    std::memcpy(input + CHECKSUM_PREFIX.size(), addr.bytes_.data(), 32);
+    input[CHECKSUM_PREFIX.size() + 32] = VERSION;
+    auto digest = sha3_256(input, sizeof(input));
+    if (digest[0] != addr.bytes_[32] || digest[1] != addr.bytes_[33]) return std::nullopt;
+
+    return addr;
+}
+
+std::string OnionAddress::to_string() const {
+    std::string out;
+    out.reserve(ENCODED_SIZE + SUFFIX.size());
+
+    uint64_t acc = 0;
+    int bits = 0;
+    for (uint8_t b : bytes_) {
+        acc = (acc << 8) | b;
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            out.push_back(ALPHABET[(acc >> bits) & 31]);
+        }
+    }
+    out += SUFFIX;
+    return out;
+}
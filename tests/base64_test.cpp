@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Base64 round trips over every tail length and chunking, and the strict
+// decoder's rejections.
+
+#include "utils/base64.hpp"
+#include "check.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+
+std::string bytes(size_t n) {
+    std::string s(n, '\0');
+    for (size_t i = 0; i < n; ++i) s[i] = static_cast<char>(i * 37 + 11);
+    return s;
+}
+
+bool same(const std::vector<unsigned char>& a, const std::string& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(),
+        [](unsigned char x, char y) { return x == static_cast<unsigned char>(y); });
+}
+
+bool rejects(std::string_view in) {
+    std::vector<unsigned char> out;
+    std::string error;
+    return !base64::decode(in, out, error) && !error.empty() && out.empty();
+}
+
+} // namespace
+
+int main() {
+    CHECK(base64::encode(std::string_view("")) == "");
+    CHECK(base64::encode(std::string_view("f")) == "Zg==");
+    CHECK(base64::encode(std::string_view("fo")) == "Zm8=");
+    CHECK(base64::encode(std::string_view("foo")) == "Zm9v");
+    CHECK(base64::encode(std::string_view("foobar")) == "Zm9vYmFy");
+    CHECK(base64::encode(nullptr, 0).empty());
+
+    // Every tail length, past the SIMD block sizes
+    for (size_t n = 0; n < 200; ++n) {
+        std::string data = bytes(n);
+        std::string text = base64::encode(std::string_view(data));
+        CHECK(text.size() == base64::encoded_size(n));
+        CHECK(base64::decoded_size(text) == n);
+        CHECK(same(base64::decode(text), data));
+    }
+
+    // Chunked encode and decode give the one-shot result for any split
+    std::string data = bytes(100);
+    std::string whole = base64::encode(std::string_view(data));
+    for (size_t step = 1; step <= 40; ++step) {
+        base64::Encoder encoder;
+        std::string text;
+        encoder.update(nullptr, 0, text);
+        for (size_t i = 0; i < data.size(); i += step) {
+            encoder.update(data.data() + i, std::min(step, data.size() - i), text);
+        }
+        encoder.finish(text);
+        CHECK(text == whole);
+
+        base64::Decoder decoder;
+        std::vector<unsigned char> out;
+        for (size_t i = 0; i < whole.size(); i += step) {
+            CHECK(decoder.update(std::string_view(whole).substr(i, step), out));
+        }
+        CHECK(decoder.finish());
+        CHECK(same(out, data));
+    }
+
+    // Whitespace is skipped, also inside a quad
+    CHECK(same(base64::decode("Zm9v\nYm\r\nFy "), "foobar"));
+
+    // Bad padding
+    CHECK(rejects("QQ="));
+    CHECK(rejects("Q==="));
+    CHECK(rejects("===="));
+    CHECK(rejects("QQ=A"));
+    CHECK(rejects("QQ==QUFB"));
+    CHECK(rejects("Zm8=Zm8="));
+    CHECK(rejects("QR=="));
+    CHECK(rejects("QUF="));
+
+    // Bad characters and truncation
+    CHECK(rejects("Zm9v*mFy"));
+    CHECK(rejects("Zm9v-_"));
+    CHECK(rejects(std::string_view("Zm\0v", 4)));
+    CHECK(rejects("Zm9vY"));
+    CHECK(rejects(std::string(60, 'A') + "\xff" + std::string(3, 'A')));
+
+    bool threw = false;
+    try {
+        base64::decode("Zm9v!");
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    CHECK(threw);
+
+    std::cout << "base64_test: ok\n";
+    return 0;
+}
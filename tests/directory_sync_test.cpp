@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Client side of the delta sync: a full answer replaces that gate's list,
+// a delta removes only what the gate dropped, and a pioneer stays while any
+// gate still lists it.
+
+#include "client/pionniers/directory.hpp"
+#include "check.hpp"
+#include "onion_fixture.hpp"
+
+#include <iostream>
+
+namespace {
+
+uint64_t gates_of(const PioneerDirectory& dir, uint32_t n) {
+    const PioneerInfo* p = dir.snapshot()->find(test_onion(n));
+    return p ? p->gates : ~uint64_t(0);
+}
+
+bool listed(const PioneerDirectory& dir, uint32_t n) {
+    return dir.snapshot()->contains(test_onion(n));
+}
+
+GateSync full(uint64_t bit, std::vector<uint32_t> added) {
+    GateSync sync{bit, true, false, {}, {}};
+    for (uint32_t n : added) sync.added.push_back(test_onion(n));
+    return sync;
+}
+
+GateSync delta(uint64_t bit, std::vector<uint32_t> added, std::vector<uint32_t> removed) {
+    GateSync sync{bit, false, false, {}, {}};
+    for (uint32_t n : added) sync.added.push_back(test_onion(n));
+    for (uint32_t n : removed) sync.removed.push_back(test_onion(n));
+    return sync;
+}
+
+} // namespace
+
+int main() {
+    const uint64_t g1 = 1, g2 = 2, live = g1 | g2;
+    PioneerDirectory dir;
+
+    CHECK(dir.apply_gate_syncs({full(g1, {1, 2, 3}), full(g2, {3, 4})}, live, "gates"));
+    CHECK(dir.size() == 4);
+    CHECK(dir.snapshot()->source == "gates");
+    CHECK(gates_of(dir, 1) == g1 && gates_of(dir, 3) == (g1 | g2) && gates_of(dir, 4) == g2);
+
+    // Nothing new, nothing published
+    uint64_t version = dir.snapshot()->version;
+    CHECK(!dir.apply_gate_syncs({delta(g1, {}, {}), delta(g2, {4}, {})}, live, "gates"));
+    CHECK(dir.snapshot()->version == version);
+
+    // Delta removals: gone once no gate has it
+    CHECK(dir.apply_gate_syncs({delta(g1, {}, {1, 3})}, live));
+    CHECK(!listed(dir, 1));
+    CHECK(listed(dir, 3) && gates_of(dir, 3) == g2);
+
+    // A full list drops what it no longer names
+    CHECK(dir.apply_gate_syncs({full(g2, {4})}, live));
+    CHECK(!listed(dir, 3));
+    CHECK(dir.apply_gate_syncs({full(g1, {2, 5})}, live));
+    CHECK(listed(dir, 2) && listed(dir, 5) && listed(dir, 4));
+
+    // Dropped by one gate and announced by another in the same round
+    CHECK(dir.apply_gate_syncs({delta(g1, {}, {2}), delta(g2, {2}, {})}, live));
+    CHECK(listed(dir, 2) && gates_of(dir, 2) == g2);
+
+    // A federated gate speaks for all of them
+    GateSync fed = delta(g1, {}, {4});
+    fed.federated = true;
+    CHECK(dir.apply_gate_syncs({fed}, live));
+    CHECK(!listed(dir, 4));
+
+    // Bits of a gate that is gone are cleared, the pioneer stays until a
+    // live gate drops it
+    CHECK(dir.apply_gate_syncs({}, g1));
+    CHECK(gates_of(dir, 2) == 0);
+    CHECK(listed(dir, 2));
+
+    // Untracked gates (bit 0) can add but never hold a pioneer
+    CHECK(dir.apply_gate_syncs({delta(0, {6}, {})}, g1));
+    CHECK(listed(dir, 6) && gates_of(dir, 6) == 0);
+    CHECK(dir.apply_gate_syncs({delta(g1, {}, {6})}, g1));
+    CHECK(!listed(dir, 6));
+
+    std::cout << "directory_sync_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Feed download: PostStreamParser gives the same posts however the body is
+// cut into chunks, drops oversized posts, and FeedMerger keeps the first
+// copy of every post in the order it was seen.
+
+#include "client/feed/feed.hpp"
+#include "check.hpp"
+
+#include <iostream>
+
+namespace {
+
+const std::string DELIMITER = "\n---END---\n";
+
+std::vector<std::string> parse(const std::string& body, size_t chunk) {
+    std::vector<std::string> posts;
+    PostStreamParser parser([&](std::string post) { posts.push_back(std::move(post)); });
+    for (size_t i = 0; i < body.size(); i += chunk) {
+        parser.feed(std::string_view(body).substr(i, chunk));
+    }
+    parser.finish();
+    return posts;
+}
+
+} // namespace
+
+int main() {
+    const std::string body = "first post" + DELIMITER + "  second\nwith lines  " + DELIMITER +
+                             " \n " + DELIMITER + "---END--- is not a delimiter" + DELIMITER +
+                             "last, no delimiter after it\n";
+    const std::vector<std::string> expected = {
+        "first post", "second\nwith lines", "---END--- is not a delimiter", "last, no delimiter after it"};
+
+    // Every chunk size, so delimiters are cut at every offset
+    for (size_t chunk = 1; chunk <= body.size(); ++chunk) {
+        CHECK(parse(body, chunk) == expected);
+    }
+
+    std::vector<std::string> posts;
+    PostStreamParser parser([&](std::string post) { posts.push_back(std::move(post)); });
+    parser.feed("a" + DELIMITER.substr(0, 4));
+    parser.feed(DELIMITER.substr(4) + "b" + DELIMITER);
+    CHECK(parser.emitted() == 2);
+    parser.finish();
+    CHECK(parser.emitted() == 2);        // nothing left after the delimiter
+    CHECK((posts == std::vector<std::string>{"a", "b"}));
+
+    // An oversized post is dropped, in one piece or streamed, the rest stays
+    const std::string huge(PostStreamParser::MAX_POST_SIZE + 10, 'x');
+    const std::string with_huge = "before" + DELIMITER + huge + DELIMITER + "after" + DELIMITER;
+    CHECK((parse(with_huge, with_huge.size()) == std::vector<std::string>{"before", "after"}));
+    CHECK((parse(with_huge, 4096) == std::vector<std::string>{"before", "after"}));
+    CHECK((parse(with_huge, 1000003) == std::vector<std::string>{"before", "after"}));
+    CHECK((parse("before" + DELIMITER + huge, 4096) == std::vector<std::string>{"before"}));
+
+    const std::string biggest(PostStreamParser::MAX_POST_SIZE, 'y');
+    CHECK(parse(biggest + DELIMITER, 4096) == std::vector<std::string>{biggest});
+
+    // Merging answers of several pioneers
+    std::vector<FeedPost> feed = {{post_hash("old"), "old"}};
+    FeedMerger merger(feed);
+    CHECK(merger.contains("old"));
+    CHECK(!merger.add("old"));
+    CHECK(merger.add("one"));
+    CHECK(merger.add("two"));
+    CHECK(!merger.add("one"));
+    CHECK(merger.add("One"));
+    CHECK(merger.size() == 4);
+    CHECK(feed[1].text == "one" && feed[2].text == "two" && feed[3].text == "One");
+    CHECK(feed[2].hash == post_hash("two"));
+    CHECK(!merger.contains("three"));
+
+    // FNV-1a reference values
+    CHECK(post_hash("") == 14695981039346656037ull);
+    CHECK(post_hash("a") == 0xaf63dc4c8601ec8cull);
+
+    std::cout << "feed_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Gossip between federated gates: both sides converge on the same set,
+// removals travel as tombstones that older adds cannot undo, and changes
+// stamped too far ahead of the clock are refused with the rest of their
+// origin's batch.
+
+#include "gate/federation/federation.hpp"
+#include "check.hpp"
+#include "onion_fixture.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+namespace {
+
+// One round as the worker runs it: `from` pushes what `to` lacks and
+// merges the answer
+void gossip(PionnierRegistry& from, GateFederation& to, const VersionVector& to_vv,
+            size_t limit = GateFederation::BATCH_LIMIT) {
+    GossipMessage out;
+    out.sender = from.origin_id();
+    out.vv = from.version_vector();
+    out.changes = from.changes_for(to_vv, limit);
+
+    GossipMessage in;
+    decode_gossip(to.handle_gossip(encode_gossip(out)), in);
+    from.apply_remote(in.changes);
+}
+
+std::vector<OnionAddress> sorted(std::vector<OnionAddress> v) {
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+bool has(const PionnierRegistry& r, const OnionAddress& a) {
+    auto list = r.snapshot();
+    return std::find(list.begin(), list.end(), a) != list.end();
+}
+
+} // namespace
+
+int main() {
+    const std::string secret(GateFederation::MIN_SECRET_SIZE, 's');
+
+    // Wire format round trip, garbage is refused
+    GossipMessage msg{42, {{1, 7}, {9, 3}}, {{1, 7, 11, true, test_onion(1)}, {9, 3, 12, false, test_onion(2)}}};
+    GossipMessage back;
+    CHECK(decode_gossip(encode_gossip(msg), back));
+    CHECK(back.sender == 42 && back.vv == msg.vv && back.changes.size() == 2);
+    CHECK(back.changes[1].origin == 9 && back.changes[1].stamp == 12 && !back.changes[1].added);
+    CHECK(back.changes[1].address == test_onion(2));
+    GossipMessage junk;
+    CHECK(!decode_gossip("hello\n", junk));
+    CHECK(!decode_gossip("gossip 1\nc 1 1 1 *" + test_onion_text(1) + "\n", junk));
+    CHECK(!decode_gossip("gossip 1\nc 1 1 1 +nope.onion\n", junk));
+
+    PionnierRegistry a, b;
+    GateFederation fed_b(b, {}, secret, 9050);
+    CHECK(fed_b.authorized(secret));
+    CHECK(!fed_b.authorized(secret.substr(1) + "t"));
+
+    a.add(test_onion(1));
+    a.add(test_onion(2));
+    b.add(test_onion(3));
+    gossip(a, fed_b, b.version_vector());
+    CHECK(sorted(a.snapshot()) == sorted(b.snapshot()));
+    CHECK(a.size() == 3);
+    CHECK(a.changes_for(b.version_vector(), 100).empty());
+    CHECK(b.changes_for(a.version_vector(), 100).empty());
+
+    // A removal is a tombstone: it reaches the peer and a stale add of the
+    // same address (lower stamp) does not bring it back
+    std::vector<GossipChange> stale = a.changes_for({}, 100);
+    a.remove(test_onion(1));
+    gossip(a, fed_b, b.version_vector());
+    CHECK(!has(b, test_onion(1)));
+    CHECK(b.apply_remote(stale) == 0);
+    CHECK(!has(b, test_onion(1)));
+
+    // A late gate learns the tombstone too, whatever order it arrives in
+    PionnierRegistry c;
+    std::vector<GossipChange> all = b.changes_for({}, 100);
+    std::reverse(all.begin(), all.end());
+    c.apply_remote(stale);
+    c.apply_remote(all);
+    CHECK(sorted(c.snapshot()) == sorted(b.snapshot()));
+    CHECK(!has(c, test_onion(1)));
+
+    // Concurrent edits of one address: both sides keep the higher stamp
+    a.add(test_onion(4));
+    b.add(test_onion(4));
+    b.remove(test_onion(4));
+    gossip(a, fed_b, b.version_vector());
+    CHECK(sorted(a.snapshot()) == sorted(b.snapshot()));
+    CHECK(!has(a, test_onion(4)));
+
+    // A truncated batch leaves a usable vector, the next round sends the rest
+    PionnierRegistry d;
+    GateFederation fed_d(d, {}, secret, 9050);
+    for (uint32_t i = 10; i < 20; ++i) a.add(test_onion(i));
+    gossip(a, fed_d, d.version_vector(), 4);
+    CHECK(d.size() < a.size());
+    for (int round = 0; round < 10; ++round) gossip(a, fed_d, d.version_vector(), 4);
+    CHECK(sorted(a.snapshot()) == sorted(d.snapshot()));
+
+    // Clock lead: the far future change and everything after it from the
+    // same origin wait, other origins go through
+    PionnierRegistry e;
+    const uint64_t lead = PionnierRegistry::MAX_CLOCK_LEAD;
+    size_t applied = e.apply_remote({
+        {77, 1, lead + 100, true, test_onion(50)},
+        {77, 2, 5, true, test_onion(51)},
+        {88, 1, 3, true, test_onion(52)},
+    });
+    CHECK(applied == 1);
+    CHECK(has(e, test_onion(52)));
+    CHECK(!has(e, test_onion(50)) && !has(e, test_onion(51)));
+    CHECK(e.version_vector().count(77) == 0);
+    CHECK(e.version_vector().at(88) == 1);
+
+    // Exactly at the limit is fine, and the clock still has room after it
+    CHECK(e.apply_remote({{99, 1, 3 + lead, true, test_onion(53)}}) == 1);
+    CHECK(e.add(test_onion(54)));
+    auto changes = e.changes_for({}, 100);
+    auto local = std::find_if(changes.begin(), changes.end(),
+        [](const GossipChange& c) { return c.address == test_onion(54); });
+    CHECK(local != changes.end() && local->stamp == 4 + lead);
+
+    std::cout << "gossip_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// A probe that is cancelled before it gets an answer must not keep the
+// host blocked: the next allow() after the cooldown is let through.
+
+#include "client/network/host_health.hpp"
+#include "check.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+int main() {
+    using namespace std::chrono_literals;
+    const std::string host = "example.onion";
+    HostHealth health(50ms);
+
+    for (int i = 0; i < HostHealth::FAILURES_TO_OPEN; ++i) {
+        CHECK(health.allow(host));
+        health.record_failure(host);
+    }
+    CHECK(health.stats(host).state == BreakerState::OPEN);
+    CHECK(!health.allow(host));
+
+    std::this_thread::sleep_for(80ms);
+
+    // The probe goes out, nobody else gets through while it runs
+    bool probe = false;
+    CHECK(health.allow(host, &probe));
+    CHECK(probe);
+    CHECK(!health.allow(host));
+
+    // Cancelled (a fan-out had enough answers), then the next caller probes
+    health.abandon(host);
+    CHECK(health.stats(host).state == BreakerState::HALF_OPEN);
+    probe = false;
+    CHECK(health.allow(host, &probe));
+    CHECK(probe);
+
+    // A real answer still closes the circuit
+    health.record_success(host, 100);
+    CHECK(health.stats(host).state == BreakerState::CLOSED);
+    probe = true;
+    CHECK(health.allow(host, &probe));
+    CHECK(!probe);
+
+    // Abandoning a transfer of a healthy host changes nothing
+    health.abandon(host);
+    CHECK(health.stats(host).state == BreakerState::CLOSED);
+
+    std::cout << "host_health_test: ok\n";
+    return 0;
+}
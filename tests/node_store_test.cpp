@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// NodeStore recovery: a commit whose header never made it to the disk, a
+// damaged newest header and a torn tail all load as the previous commit,
+// and the next commit after that is readable again. The store loads once
+// per process, so every reader runs in a fresh child.
+
+#include "client/pionniers/node_store.hpp"
+#include "client/config.hpp"
+#include "check.hpp"
+#include "onion_fixture.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Exit code of `body` run in a child process
+int in_child(const std::function<int()>& body) {
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) _exit(body());
+    int status = 0;
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status)) return -1;
+    return WEXITSTATUS(status);
+}
+
+std::vector<PioneerInfo> sample(double score) {
+    std::vector<PioneerInfo> list;
+    for (uint32_t i = 0; i < 5; ++i) list.push_back({test_onion(i), score + i, 1000 + i, 1ull << i});
+    return list;
+}
+
+// Child: the store holds `gates` and sample(score)
+int expect(const std::vector<std::string>& gates, double score) {
+    std::vector<std::string> g;
+    std::vector<PioneerInfo> p;
+    CHECK(NodeStore::instance().load(g, p));
+    CHECK(g == gates);
+    auto want = sample(score);
+    CHECK(p.size() == want.size());
+    for (size_t i = 0; i < p.size(); ++i) {
+        CHECK(p[i].address == want[i].address);
+        CHECK(p[i].score == want[i].score);
+        CHECK(p[i].last_seen == want[i].last_seen);
+        CHECK(p[i].gates == want[i].gates);
+    }
+    return 0;
+}
+
+std::string read_file() {
+    std::ifstream in(Config::NODES_FILE, std::ios::binary);
+    return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+}
+
+void write_file(const std::string& data) {
+    std::ofstream(Config::NODES_FILE, std::ios::binary | std::ios::trunc) << data;
+}
+
+uint64_t generation(const std::string& data, int slot) {
+    uint64_t g = 0;
+    for (int i = 0; i < 8; ++i) g |= uint64_t(uint8_t(data[slot * NodeStore::HEADER_SIZE + 16 + i])) << (8 * i);
+    return g;
+}
+
+} // namespace
+
+int main() {
+    const fs::path dir = fs::temp_directory_path() / ("torsper_node_store_test_" + std::to_string(getpid()));
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    fs::current_path(dir);      // Config::NODES_FILE is relative
+
+    const std::vector<std::string> gates = {test_onion_text(100), test_onion_text(101)};
+
+    // No file yet
+    CHECK(in_child([] {
+        std::vector<std::string> g;
+        std::vector<PioneerInfo> p;
+        CHECK(!NodeStore::instance().load(g, p));
+        return 0;
+    }) == 0);
+
+    // Two commits, the second only moves scores
+    CHECK(in_child([&] {
+        CHECK(NodeStore::instance().commit_gates(gates));
+        CHECK(NodeStore::instance().commit_pioneers(sample(1)));
+        return 0;
+    }) == 0);
+    CHECK(in_child([&] { return expect(gates, 1); }) == 0);
+    const std::string first = read_file();
+
+    CHECK(in_child([] { return NodeStore::instance().commit_pioneers(sample(2)) ? 0 : 1; }) == 0);
+    CHECK(in_child([&] { return expect(gates, 2); }) == 0);
+    const std::string second = read_file();
+    CHECK(second.size() > first.size());
+
+    // Crash after the records, before the header: the old headers name
+    // only the first commit's records
+    write_file(first.substr(0, 2 * NodeStore::HEADER_SIZE) + second.substr(2 * NodeStore::HEADER_SIZE));
+    CHECK(in_child([&] { return expect(gates, 1); }) == 0);
+
+    // Torn newest header: the other slot still has the first commit
+    std::string damaged = second;
+    int newest = generation(second, 0) > generation(second, 1) ? 0 : 1;
+    damaged[newest * NodeStore::HEADER_SIZE + 20] ^= 0x40;
+    write_file(damaged);
+    CHECK(in_child([&] { return expect(gates, 1); }) == 0);
+
+    // Torn tail of records, then a commit on top of the recovered state
+    write_file(damaged + std::string(NodeStore::RECORD_SIZE / 2, 'z'));
+    CHECK(in_child([] { return NodeStore::instance().commit_pioneers(sample(3)) ? 0 : 1; }) == 0);
+    CHECK(in_child([&] { return expect(gates, 3); }) == 0);
+
+    // A damaged committed record keeps what precedes it, the next commit
+    // rewrites a clean file
+    std::string data = read_file();
+    data[2 * NodeStore::HEADER_SIZE + 40] ^= 0x01;
+    write_file(data);
+    CHECK(in_child([&] {
+        std::vector<std::string> g;
+        std::vector<PioneerInfo> p;
+        CHECK(NodeStore::instance().load(g, p));
+        CHECK(g.empty() && p.empty());      // the first record is the damaged one
+        CHECK(NodeStore::instance().commit_gates(gates));
+        CHECK(NodeStore::instance().commit_pioneers(sample(4)));
+        return 0;
+    }) == 0);
+    CHECK(in_child([&] { return expect(gates, 4); }) == 0);
+    CHECK(!fs::exists(Config::NODES_FILE + ".tmp"));
+
+    // Not a node store at all
+    write_file("not a node store, just some text that is long enough to fill both header slots "
+               "of the file and then some more");
+    CHECK(in_child([&] {
+        std::vector<std::string> g;
+        std::vector<PioneerInfo> p;
+        CHECK(!NodeStore::instance().load(g, p));
+        CHECK(NodeStore::instance().commit_gates(gates));
+        CHECK(NodeStore::instance().commit_pioneers(sample(5)));
+        return 0;
+    }) == 0);
+    CHECK(in_child([&] { return expect(gates, 5); }) == 0);
+
+    fs::current_path(fs::temp_directory_path());
+    fs::remove_all(dir);
+    std::cout << "node_store_test: ok\n";
+    return 0;
+}
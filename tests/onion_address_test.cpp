@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// OnionAddress accepts only v3 addresses with a matching checksum, in any
+// case, and prints them back in canonical form.
+
+#include "utils/onion/onion_address.hpp"
+#include "check.hpp"
+#include "onion_fixture.hpp"
+
+#include <cctype>
+#include <iostream>
+#include <unordered_set>
+
+namespace {
+
+std::string hex(const std::array<uint8_t, 32>& digest) {
+    const char* digits = "0123456789abcdef";
+    std::string out;
+    for (uint8_t b : digest) {
+        out += digits[b >> 4];
+        out += digits[b & 15];
+    }
+    return out;
+}
+
+std::string upper(std::string s) {
+    for (auto& c : s) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return s;
+}
+
+} // namespace
+
+int main() {
+    // FIPS 202 test vectors
+    CHECK(hex(sha3_256(nullptr, 0)) == "a7ffc6f8bf1ed76651c14756a061d662f580ff4de43b49fa82d80a4b80f8434a");
+    const std::string abc = "abc";
+    CHECK(hex(sha3_256(reinterpret_cast<const uint8_t*>(abc.data()), abc.size())) ==
+          "3a985da74fe225b2045c172d6bd390bd855f086e3e9d525b46bfe24511431532");
+
+    // A published service
+    const std::string ddg = "duckduckgogg42xjoc72x3sjasowoarfbgcmvfimaftt6twagswzczad.onion";
+    auto parsed = OnionAddress::parse(ddg);
+    CHECK(parsed);
+    CHECK(parsed->to_string() == ddg);
+    CHECK(parsed->bytes()[34] == OnionAddress::VERSION);
+
+    // With or without the suffix, any case, always printed canonical
+    CHECK(OnionAddress::parse(ddg.substr(0, OnionAddress::ENCODED_SIZE)) == parsed);
+    CHECK(OnionAddress::parse(upper(ddg)) == parsed);
+    CHECK(OnionAddress::parse(upper(ddg))->to_string() == ddg);
+
+    // Checksum, version, alphabet and length are all checked
+    std::string typo = ddg;
+    typo[5] = typo[5] == 'a' ? 'b' : 'a';
+    CHECK(!OnionAddress::is_valid(typo));
+    std::string version = test_onion_text(1);
+    version[55] = version[55] == 'd' ? 'c' : 'd';     // last char carries the version
+    CHECK(!OnionAddress::is_valid(version));
+    CHECK(!OnionAddress::is_valid(ddg.substr(0, 55) + "1.onion"));
+    CHECK(!OnionAddress::is_valid(ddg.substr(1)));
+    CHECK(!OnionAddress::is_valid(ddg + "x"));
+    CHECK(!OnionAddress::is_valid(ddg.substr(0, OnionAddress::ENCODED_SIZE) + ".oniox"));
+    CHECK(!OnionAddress::is_valid("expyuzz4wqqyqhjn.onion"));   // v2
+    CHECK(!OnionAddress::is_valid(""));
+
+    // Distinct keys stay distinct in hashed containers
+    std::unordered_set<OnionAddress> seen;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        OnionAddress a = test_onion(i);
+        CHECK(OnionAddress::parse(a.to_string()) == a);
+        CHECK(seen.insert(a).second);
+    }
+    CHECK(test_onion(1) != test_onion(2));
+    CHECK(test_onion(1) < test_onion(2) || test_onion(2) < test_onion(1));
+
+    std::cout << "onion_address_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "utils/onion/onion_address.hpp"
+
+// Valid v3 addresses for the tests: key from `n`, checksum computed the way
+// Tor does, so OnionAddress::parse accepts them
+inline std::string test_onion_text(uint32_t n) {
+    uint8_t raw[OnionAddress::SIZE] = {};
+    std::memcpy(raw, &n, sizeof(n));
+    raw[31] = 0x5a;
+
+    const std::string prefix = ".onion checksum";
+    std::vector<uint8_t> in(prefix.begin(), prefix.end());
+    in.insert(in.end(), raw, raw + 32);
+    in.push_back(OnionAddress::VERSION);
+    auto digest = sha3_256(in.data(), in.size());
+    raw[32] = digest[0];
+    raw[33] = digest[1];
+    raw[34] = OnionAddress::VERSION;
+
+    const char* alphabet = "abcdefghijklmnopqrstuvwxyz234567";
+    std::string text;
+    uint32_t acc = 0;
+    int bits = 0;
+    for (uint8_t b : raw) {
+        acc = (acc << 8) | b;
+        bits += 8;
+        while (bits >= 5) {
+            bits -= 5;
+            text += alphabet[(acc >> bits) & 31];
+        }
+    }
+    return text + ".onion";
+}
+
+inline OnionAddress test_onion(uint32_t n) {
+    return *OnionAddress::parse(test_onion_text(n));
+}
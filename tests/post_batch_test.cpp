@@ -0,0 +1,72 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Framing of POST /add_posts: well formed batches split into their posts,
+// anything else is rejected without reading past the body.
+
+#include "pionnier/post_batch.hpp"
+#include "check.hpp"
+
+#include <iostream>
+
+namespace {
+
+bool rejects(const std::string& body) {
+    std::vector<std::string_view> out;
+    std::string error;
+    return !parse_post_batch(body, out, error) && !error.empty();
+}
+
+} // namespace
+
+int main() {
+    std::vector<std::string_view> out;
+    std::string error;
+
+    CHECK(parse_post_batch("3\nabc\n0\n\n5\na\nb\nc\n", out, error));
+    CHECK(out.size() == 3);
+    CHECK(out[0] == "abc");
+    CHECK(out[1].empty());
+    CHECK(out[2] == "a\nb\nc");
+
+    out.clear();
+    CHECK(parse_post_batch("", out, error));
+    CHECK(out.empty());
+
+    // Lengths that overflow size_t or pass the cap
+    CHECK(rejects("18446744073709551615\nabc"));
+    CHECK(rejects("99999999999999999999999999\nabc\n"));
+    CHECK(rejects(std::to_string(MAX_POST_SIZE + 1) + "\n" + std::string(MAX_POST_SIZE + 1, 'x') + "\n"));
+
+    // Truncated bodies: short text, missing terminator, no length line end
+    CHECK(rejects("10\nabc"));
+    CHECK(rejects("3\nabc"));
+    CHECK(rejects("3\nabcd\n"));
+    CHECK(rejects("3\nabc\n4"));
+    CHECK(rejects("3"));
+
+    // Bad length lines
+    CHECK(rejects("\nabc\n"));
+    CHECK(rejects("-3\nabc\n"));
+    CHECK(rejects("3 \nabc\n"));
+
+    std::string many;
+    for (size_t i = 0; i <= MAX_BATCH_POSTS; ++i) many += "1\nx\n";
+    CHECK(rejects(many));
+
+    std::cout << "post_batch_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Registry storage: the snapshot plus journal bring back the epoch, the
+// versions, the members and the tombstones after a restart, a torn journal
+// line is skipped, and a journal set aside by an interrupted compaction is
+// replayed without applying anything twice.
+
+#include "gate/registry/registry.hpp"
+#include "check.hpp"
+#include "onion_fixture.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::vector<OnionAddress> sorted(std::vector<OnionAddress> v) {
+    std::sort(v.begin(), v.end());
+    return v;
+}
+
+} // namespace
+
+int main() {
+    const fs::path dir = fs::temp_directory_path() / ("torsper_registry_test_" + std::to_string(getpid()));
+    fs::remove_all(dir);
+
+    uint64_t epoch, version;
+    std::vector<OnionAddress> members;
+    {
+        PionnierRegistry r;
+        CHECK(r.open_storage(dir));
+        for (uint32_t i = 0; i < 10; ++i) r.add(test_onion(i));
+        r.remove(test_onion(3));
+        r.apply_remote({{77, 1, 100, true, test_onion(20)}});
+        epoch = r.epoch();
+        version = r.version();
+        members = r.snapshot();
+    }
+    CHECK(fs::exists(dir / "registry.snap"));
+    CHECK(fs::file_size(dir / "registry.journal") > 0);
+
+    // Torn last line of a crash
+    {
+        std::ofstream journal(dir / "registry.journal", std::ios::app);
+        journal << "j 1 2 3 +" << test_onion_text(30).substr(0, 20);
+    }
+
+    {
+        PionnierRegistry r;
+        CHECK(r.open_storage(dir));
+        CHECK(r.epoch() == epoch);
+        CHECK(r.version() == version);
+        CHECK(r.snapshot() == members);        // registration order too
+        CHECK(r.version_vector().at(77) == 1);
+
+        // Replaying the journal rebuilt the history since the snapshot
+        CHECK(r.render_since(epoch, version) ==
+              "delta " + std::to_string(epoch) + " " + std::to_string(version) + "\n");
+        CHECK(r.render_since(epoch, version - 1) ==
+              "delta " + std::to_string(epoch) + " " + std::to_string(version) + "\n+" +
+              test_onion_text(20) + "\n");
+
+        // The tombstone is still there for gossip
+        auto changes = r.changes_for({}, 100);
+        CHECK(std::any_of(changes.begin(), changes.end(), [](const GossipChange& c) {
+            return c.address == test_onion(3) && !c.added;
+        }));
+
+        // Local changes continue the old sequence
+        CHECK(r.add(test_onion(40)));
+        CHECK(r.version() == version + 1);
+        CHECK(r.version_vector().at(epoch) == 12);
+    }
+
+    // A compaction that crashed after setting the journal aside: its
+    // changes are replayed from registry.journal.old
+    {
+        PionnierRegistry r;
+        CHECK(r.open_storage(dir));
+        r.add(test_onion(41));
+        r.remove(test_onion(0));
+        version = r.version();
+        members = r.snapshot();
+    }
+    fs::rename(dir / "registry.journal", dir / "registry.journal.old");
+    std::ofstream(dir / "registry.journal").close();
+    fs::copy_file(dir / "registry.journal.old", dir / "journal.copy");
+    {
+        PionnierRegistry r;
+        CHECK(r.open_storage(dir));
+        CHECK(r.version() == version);
+        CHECK(sorted(r.snapshot()) == sorted(members));
+        CHECK(!fs::exists(dir / "registry.journal.old"));
+    }
+
+    // The same journal once more, now that the snapshot has it: nothing
+    // is applied twice, the version stays
+    fs::rename(dir / "journal.copy", dir / "registry.journal.old");
+    {
+        PionnierRegistry r;
+        CHECK(r.open_storage(dir));
+        CHECK(r.version() == version);
+        CHECK(sorted(r.snapshot()) == sorted(members));
+
+        // Versions before the snapshot are not answerable as a delta
+        CHECK(r.render_since(r.epoch(), version - 1).rfind("full ", 0) == 0);
+    }
+
+    // Enough entries to compact while running
+    {
+        PionnierRegistry r;
+        CHECK(r.open_storage(dir));
+        std::vector<OnionAddress> batch;
+        for (uint32_t i = 0; i < PionnierRegistry::JOURNAL_COMPACT_AT + 10; ++i) batch.push_back(test_onion(1000 + i));
+        r.add_batch(batch);
+        r.add(test_onion(42));
+        CHECK(fs::file_size(dir / "registry.journal") < 1000);
+        version = r.version();
+        members = r.snapshot();
+    }
+    {
+        PionnierRegistry r;
+        CHECK(r.open_storage(dir));
+        CHECK(r.version() == version);
+        CHECK(r.snapshot() == members);
+    }
+
+    fs::remove_all(dir);
+    std::cout << "registry_storage_test: ok\n";
+    return 0;
+}
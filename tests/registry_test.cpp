@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Versioned gate registry: /get_pionniers?since= answers with a delta while
+// the history reaches back that far, with the full list otherwise, and the
+// /add_pionniers batch parser rejects a body on its first bad line.
+
+#include "gate/registry/registry.hpp"
+#include "check.hpp"
+#include "onion_fixture.hpp"
+
+#include <iostream>
+
+int main() {
+    PionnierRegistry registry;
+    const uint64_t epoch = registry.epoch();
+    CHECK(epoch != 0);
+    CHECK(registry.version() == 0);
+
+    for (uint32_t i = 0; i < 5; ++i) CHECK(registry.add(test_onion(i)));
+    CHECK(registry.version() == 5);
+    CHECK(!registry.add(test_onion(0)));       // no change, no version
+    CHECK(!registry.remove(test_onion(99)));
+    CHECK(registry.version() == 5);
+
+    // Delta from version 2: the three later additions, oldest first
+    std::vector<RegistryChange> changes;
+    CHECK(registry.changes_since(epoch, 2, changes));
+    CHECK(changes.size() == 3);
+    CHECK(changes[0].version == 3 && changes[0].added && changes[0].address == test_onion(2));
+    CHECK(changes[2].version == 5 && changes[2].address == test_onion(4));
+
+    CHECK(registry.remove(test_onion(1)));
+    CHECK(registry.changes_since(epoch, 5, changes));
+    CHECK(changes.size() == 1);
+    CHECK(!changes[0].added && changes[0].address == test_onion(1));
+
+    CHECK(registry.changes_since(epoch, 6, changes));
+    CHECK(changes.empty());
+    CHECK(registry.render_since(epoch, 6) == "delta " + std::to_string(epoch) + " 6\n");
+    CHECK(registry.render_since(epoch, 5) ==
+          "delta " + std::to_string(epoch) + " 6\n-" + test_onion_text(1) + "\n");
+
+    // A version from the future or another epoch gets the full list
+    CHECK(!registry.changes_since(epoch, 7, changes));
+    CHECK(!registry.changes_since(epoch + 1, 5, changes));
+    std::string full = registry.render_since(epoch + 1, 5);
+    CHECK(full.rfind("full " + std::to_string(epoch) + " 6\n", 0) == 0);
+    CHECK(full.find("+" + test_onion_text(0) + "\n") != std::string::npos);
+    CHECK(full.find(test_onion_text(1)) == std::string::npos);
+    CHECK(registry.snapshot().size() == 4);
+
+    registry.set_federated(true);
+    CHECK(registry.render_since(epoch, 6) == "delta " + std::to_string(epoch) + " 6 federated\n");
+
+    // A fresh registry (lost history) has a new epoch, old cursors resync
+    PionnierRegistry fresh;
+    CHECK(fresh.epoch() != epoch);
+    CHECK(fresh.render_since(epoch, 6).rfind("full ", 0) == 0);
+    CHECK(fresh.render_since(fresh.epoch(), 0) == "delta " + std::to_string(fresh.epoch()) + " 0\n");
+
+    // Once the bounded history drops a version, it is answered in full
+    PionnierRegistry busy;
+    std::vector<OnionAddress> batch;
+    for (uint32_t i = 0; i < PionnierRegistry::MAX_HISTORY + 10; ++i) batch.push_back(test_onion(1000 + i));
+    batch.push_back(test_onion(1000));
+    CHECK(busy.add_batch(batch) == PionnierRegistry::MAX_HISTORY + 10);
+    CHECK(!busy.changes_since(busy.epoch(), 9, changes));
+    CHECK(busy.changes_since(busy.epoch(), 10, changes));
+    CHECK(changes.size() == PionnierRegistry::MAX_HISTORY);
+
+    // /add_pionniers bodies
+    std::vector<OnionAddress> parsed;
+    std::string error;
+    std::string body = "  " + test_onion_text(1) + "\r\n\n" + test_onion_text(2).substr(0, 56) + "\n\t\n";
+    CHECK(parse_onion_batch(body, parsed, error));
+    CHECK(parsed.size() == 2);
+    CHECK(parsed[0] == test_onion(1) && parsed[1] == test_onion(2));
+
+    parsed.clear();
+    CHECK(parse_onion_batch("", parsed, error));
+    CHECK(parse_onion_batch("\n\n", parsed, error));
+    CHECK(parsed.empty());
+
+    std::string bad = test_onion_text(3);
+    bad[0] = bad[0] == 'a' ? 'b' : 'a';
+    CHECK(!parse_onion_batch(test_onion_text(1) + "\n\n" + bad + "\n" + test_onion_text(2), parsed, error));
+    CHECK(error == "line 3: invalid onion address");
+    parsed.clear();
+    CHECK(!parse_onion_batch(test_onion_text(1) + " " + test_onion_text(2), parsed, error));
+    CHECK(!parse_onion_batch("not an onion", parsed, error));
+    CHECK(error == "line 1: invalid onion address");
+
+    std::cout << "registry_test: ok\n";
+    return 0;
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2025 Anatoly Nikolaevich
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+// Servers launch Tor from a thread that ends once it is up. The process
+// must outlive that thread, still go away with terminate(), and keep
+// running after detach().
+
+#include "utils/tor/tor_process.hpp"
+#include "check.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using namespace std::chrono_literals;
+
+// Polls `done` every few milliseconds until it holds or `limit` passed
+template <typename Pred>
+bool wait_until(Pred done, std::chrono::milliseconds limit = 10s) {
+    auto deadline = std::chrono::steady_clock::now() + limit;
+    while (!done()) {
+        if (std::chrono::steady_clock::now() >= deadline) return false;
+        std::this_thread::sleep_for(10ms);
+    }
+    return true;
+}
+
+// Shell loop that waits for `path` to appear
+std::string wait_for_file(const fs::path& path) {
+    return "while [ ! -e '" + path.string() + "' ]; do sleep 0.01; done";
+}
+
+} // namespace
+
+int main() {
+    const fs::path dir = fs::temp_directory_path() / ("tor_process_test_" + std::to_string(TorProcess::current_pid()));
+    fs::remove_all(dir);
+    fs::create_directories(dir);
+    const fs::path go = dir / "go";
+    const fs::path done = dir / "done";
+
+    // The child reports once the launcher thread is gone, so a child tied
+    // to that thread would exit before saying anything
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::vector<std::string> lines;
+    auto on_line = [&](const std::string& line) {
+        std::lock_guard<std::mutex> lk(mtx);
+        lines.push_back(line);
+        cv.notify_all();
+    };
+    auto on_exit = [&](int) { cv.notify_all(); };
+
+    TorProcess process;
+
+    // The launcher stays until the first output line, as it would waiting
+    // for the bootstrap
+    std::thread launcher([&] {
+        process.start("sh", {"-c", "echo started; " + wait_for_file(go) + "; echo alive; exec sleep 30"},
+                      on_line, on_exit);
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait_for(lk, 10s, [&] { return !lines.empty() || !process.running(); });
+    });
+    launcher.join();
+    CHECK(process.running());
+
+    std::ofstream(go).close();
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait_for(lk, 10s, [&] { return lines.size() >= 2 || !process.running(); });
+        CHECK(lines.size() == 2 && lines[1] == "alive");
+    }
+    CHECK(process.running());
+    CHECK(!process.exit_code());
+
+    process.terminate();
+    CHECK(!process.running());
+    CHECK(process.exit_code() == 128 + SIGTERM);
+
+    // A missing executable fails in the child, it exits with 127
+    process.start("/nonexistent/tor", {});
+    CHECK(wait_until([&] { return !process.running(); }));
+    CHECK(process.exit_code() == 127);
+
+    // Handed over: nobody waits for it, it still does its work afterwards
+    fs::remove(go);
+    process.start("sh", {"-c", wait_for_file(go) + "; touch '" + done.string() + "'"});
+    process.detach();
+    CHECK(!process.running());
+    std::ofstream(go).close();
+    CHECK(wait_until([&] { return fs::exists(done); }));
+
+    fs::remove_all(dir);
+    return 0;
+}